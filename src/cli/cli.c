@@ -1,16 +1,21 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <net/if.h>
+#include <arpa/inet.h>
 
 #include "cli.h"
 #include "switch/switch.h"
+#include "switch/mac_table.h"
+#include "switch/acl.h"
 
 /*------------------------------------------------------------------------------
  * Definitions
  *----------------------------------------------------------------------------*/
-#define CMD_BUFFER_SIZE 200
-#define MAX_ARGS 8
+#define CMD_BUFFER_SIZE 512
+#define MAX_ARGS 32
+#define DEFAULT_BUSY_POLL_IDLE_US 1000
 
 /*------------------------------------------------------------------------------
  * Types
@@ -26,6 +31,8 @@ typedef struct {
 /*------------------------------------------------------------------------------
  * Static Variables
  *----------------------------------------------------------------------------*/
+static switch_t *current_switch; // Instance the port commands apply to (NULL if none)
+static bool defer_acl_commits;   // true while running a config file: ACLs are compiled once at the end
 
 /*------------------------------------------------------------------------------
  * Static Function Declarations
@@ -66,6 +73,133 @@ static void cmd_disconnect(int argc, char **argv);
  * @param argv The arguments
  */
 static void cmd_show(int argc, char **argv);
+
+/**
+ * @brief Handle the busypoll command.
+ *        Switch the engine between busy-poll and blocking mode.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_busypoll(int argc, char **argv);
+
+/**
+ * @brief Handle the stats command.
+ *        Show the switch engine stats.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_stats(int argc, char **argv);
+
+/**
+ * @brief Handle the latency command.
+ *        Show or reset the switching latency histograms.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_latency(int argc, char **argv);
+
+/**
+ * @brief Handle the mac command.
+ *        Show the MAC table, or add/remove static entries.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_mac(int argc, char **argv);
+
+/**
+ * @brief Handle the acl command.
+ *        Show, add or remove the ingress ACL rules of a port.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_acl(int argc, char **argv);
+
+/**
+ * @brief Handle the create command.
+ *        Create and start a new switch instance and select it.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_create(int argc, char **argv);
+
+/**
+ * @brief Handle the delete command.
+ *        Stop and remove a switch instance.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_delete(int argc, char **argv);
+
+/**
+ * @brief Handle the use command.
+ *        Select the switch instance the port commands apply to.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_use(int argc, char **argv);
+
+/**
+ * @brief Handle the list command.
+ *        List all switch instances.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ */
+static void cmd_list(int argc, char **argv);
+
+/**
+ * @brief Get the selected switch instance, or tell the user to select one.
+ *
+ * @return The selected instance, or NULL if none is selected
+ */
+static switch_t *selected_switch(void);
+
+/**
+ * @brief Parse a MAC address in aa:bb:cc:dd:ee:ff notation.
+ *
+ * @param str The string to parse
+ * @param mac The parsed MAC address
+ * @return 0 on success, -1 on invalid format
+ */
+static int parse_mac(const char *str, unsigned char *mac);
+
+/**
+ * @brief Parse an IPv4 or IPv6 address with an optional prefix length
+ *        into the IPv4-mapped form used by ACL keys.
+ *
+ * @param str The string to parse, e.g. "10.0.0.0/24" or "fe80::/10"
+ * @param ip The address
+ * @param mask The prefix mask
+ * @return 0 on success, -1 on invalid format
+ */
+static int parse_ip_prefix(const char *str, uint8_t *ip, uint8_t *mask);
+
+/**
+ * @brief Parse "<priority> <action> [match...]" into an ACL rule.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments, starting with the priority
+ * @param rule The parsed rule
+ * @return 0 on success, -1 on invalid syntax (an error has been printed)
+ */
+static int parse_acl_rule(int argc, char **argv, acl_rule_t *rule);
+
+/**
+ * @brief Parse and run one command line.
+ *
+ * @param line The command line (modified in place)
+ * @return 1 if the line was "exit", 0 otherwise
+ */
+static int execute_line(char *line);
+
 /**
  * @brief Parse the arguments from a command line.
  *
@@ -87,9 +221,18 @@ static cli_command_t *find_command(const char *name);
  * Command Table
  *----------------------------------------------------------------------------*/
  static cli_command_t commands[] = {
+    {"create", cmd_create, "create <name>             - Create a switch instance and select it"},
+    {"delete", cmd_delete, "delete <name>             - Stop and remove a switch instance"},
+    {"use", cmd_use, "use <name>                - Select the switch instance the commands below apply to"},
+    {"list", cmd_list, "list                      - List all switch instances"},
     {"connect", cmd_connect, "connect <port> <interface> - Bind a switch port to a network interface"},
     {"disconnect", cmd_disconnect, "disconnect <port> - Disconnect a switch port from a network interface"},
     {"show", cmd_show, "Show the status of the switch ports"},
+    {"busypoll", cmd_busypoll, "busypoll on <cpu> [idle_us] | off - Pin worker N to CPU cpu+N and busy-poll the ports"},
+    {"stats", cmd_stats, "stats                     - Show the poll mode and the time spent busy, spinning and blocked"},
+    {"latency", cmd_latency, "latency [reset]           - Show (or clear) switching latency per port and path"},
+    {"acl", cmd_acl, "acl <port> [add <prio> <action> [match...] | del <id> | clear] - Show or edit the ingress ACL of a port"},
+    {"mac", cmd_mac, "mac [static add <mac> <port> | static del <mac>] - Show the MAC table or manage static entries"},
     {"help",    cmd_help,    "help                      - Show available commands"},
     {NULL, NULL, NULL}
 };
@@ -116,10 +259,15 @@ static void cmd_connect(int argc, char **argv) {
         return;
     }
 
+    switch_t *sw = selected_switch();
+    if (sw == NULL) {
+        return;
+    }
+
     int port = atoi(argv[1]);
     const char *iface = argv[2];
 
-    if (switch_connect_port(port, iface) < 0) {
+    if (switch_connect_port(sw, port, iface) < 0) {
         printf("Error: Invalid port number. Use 1-%d.\n", MAX_PORTS);
         return;
     }
@@ -133,18 +281,405 @@ static void cmd_disconnect(int argc, char **argv) {
         return;
     }
 
+    switch_t *sw = selected_switch();
+    if (sw == NULL) {
+        return;
+    }
+
     int port = atoi(argv[1]);
-    switch_disconnect_port(port);
+    switch_disconnect_port(sw, port);
 }
 
 static void cmd_show(int argc, char **argv) {
     (void)argc;
     (void)argv;
 
-    switch_show_port_status();
+    switch_t *sw = selected_switch();
+    if (sw != NULL) {
+        switch_show_port_status(sw);
+    }
+}
+
+static void cmd_busypoll(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        switch_disable_busy_poll();
+        printf("Command sent: Busy-poll mode off\n");
+        return;
+    }
+
+    if ((argc != 3 && argc != 4) || strcmp(argv[1], "on") != 0) {
+        printf("Usage: busypoll on <cpu> [idle_us] | busypoll off\n");
+        return;
+    }
+
+    int cpu = atoi(argv[2]);
+    int idle_us = (argc == 4) ? atoi(argv[3]) : DEFAULT_BUSY_POLL_IDLE_US;
+
+    if (switch_enable_busy_poll(cpu, idle_us) < 0) {
+        printf("Error: Invalid CPU or idle period.\n");
+        return;
+    }
+
+    printf("Command sent: Busy-poll on CPU %d, idle fallback after %d us\n", cpu, idle_us);
+}
+
+static void cmd_stats(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    switch_t *sw = selected_switch();
+    if (sw != NULL) {
+        switch_show_stats(sw);
+    }
+}
+
+static void cmd_latency(int argc, char **argv) {
+    switch_t *sw = selected_switch();
+    if (sw == NULL) {
+        return;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        switch_reset_latency(sw);
+        printf("Latency histograms cleared\n");
+        return;
+    }
+
+    if (argc != 1) {
+        printf("Usage: latency [reset]\n");
+        return;
+    }
+
+    switch_show_latency(sw);
+}
+
+static void cmd_mac(int argc, char **argv) {
+    unsigned char mac[MAC_ADDR_LEN];
+
+    switch_t *sw = selected_switch();
+    if (sw == NULL) {
+        return;
+    }
+
+    if (argc == 1) {
+        switch_show_mac_table(sw);
+        return;
+    }
+
+    if (argc == 5 && strcmp(argv[1], "static") == 0 && strcmp(argv[2], "add") == 0) {
+        int port = atoi(argv[4]);
+        if (parse_mac(argv[3], mac) < 0) {
+            printf("Error: Invalid MAC address '%s'.\n", argv[3]);
+            return;
+        }
+        if (switch_add_static_mac(sw, mac, port) < 0) {
+            printf("Error: Invalid port number. Use 1-%d.\n", MAX_PORTS);
+            return;
+        }
+        printf("Command sent: Static MAC %s on Port %d\n", argv[3], port);
+        return;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "static") == 0 && strcmp(argv[2], "del") == 0) {
+        if (parse_mac(argv[3], mac) < 0) {
+            printf("Error: Invalid MAC address '%s'.\n", argv[3]);
+            return;
+        }
+        switch_remove_static_mac(sw, mac);
+        printf("Command sent: Remove static MAC %s\n", argv[3]);
+        return;
+    }
+
+    printf("Usage: mac | mac static add <mac> <port> | mac static del <mac>\n");
+}
+
+static void cmd_acl(int argc, char **argv) {
+    switch_t *sw = selected_switch();
+    if (sw == NULL) {
+        return;
+    }
+
+    if (argc < 2) {
+        printf("Usage: acl <port> [add <prio> <action> [match...] | del <id> | clear]\n");
+        printf("  action: permit | deny | mirror <port> | rate-limit <pps> <burst>\n");
+        printf("  match:  src-mac <mac> dst-mac <mac> ethertype <type> vlan <id> proto <num|tcp|udp|icmp>\n");
+        printf("          src-ip <ip[/len]> dst-ip <ip[/len]> src-port <port> dst-port <port>\n");
+        return;
+    }
+
+    int port = atoi(argv[1]);
+
+    if (argc == 2) {
+        if (switch_acl_show(sw, port) < 0) {
+            printf("Error: Invalid port number. Use 1-%d.\n", MAX_PORTS);
+        }
+        return;
+    }
+
+    if (strcmp(argv[2], "add") == 0) {
+        acl_rule_t rule;
+        if (parse_acl_rule(argc - 3, &argv[3], &rule) < 0) {
+            return;
+        }
+        int id = switch_acl_add(sw, port, &rule);
+        if (id < 0) {
+            printf("Error: Invalid port number (use 1-%d) or rule, or ACL full.\n", MAX_PORTS);
+            return;
+        }
+        printf("ACL rule %d added on Port %d\n", id, port);
+    } else if (strcmp(argv[2], "del") == 0 && argc == 4) {
+        if (switch_acl_remove(sw, port, atoi(argv[3])) < 0) {
+            printf("Error: No rule %s on Port %d.\n", argv[3], port);
+            return;
+        }
+        printf("ACL rule %s removed from Port %d\n", argv[3], port);
+    } else if (strcmp(argv[2], "clear") == 0 && argc == 3) {
+        if (switch_acl_clear(sw, port) < 0) {
+            printf("Error: Invalid port number. Use 1-%d.\n", MAX_PORTS);
+            return;
+        }
+        printf("ACL of Port %d cleared\n", port);
+    } else {
+        printf("Usage: acl <port> [add <prio> <action> [match...] | del <id> | clear]\n");
+        return;
+    }
+
+    if (!defer_acl_commits && switch_acl_commit(sw) < 0) {
+        printf("Error: Cannot compile the ACL, the previous rules stay in place.\n");
+    }
+}
+
+static void cmd_create(int argc, char **argv) {
+    if (argc != 2) {
+        printf("Usage: create <name>\n");
+        return;
+    }
+
+    switch_t *sw = switch_init(argv[1]);
+    if (sw == NULL) {
+        printf("Error: Cannot create '%s' (name taken or invalid, or %d switches reached).\n", argv[1], MAX_SWITCHES);
+        printf("Names are up to %d letters, digits, '_' and '-'.\n", SWITCH_NAME_LEN - 1);
+        return;
+    }
+    switch_start(sw);
+
+    current_switch = sw;
+    printf("Switch '%s' created and selected\n", argv[1]);
+}
+
+static void cmd_delete(int argc, char **argv) {
+    if (argc != 2) {
+        printf("Usage: delete <name>\n");
+        return;
+    }
+
+    switch_t *sw = switch_find(argv[1]);
+    if (sw == NULL) {
+        printf("Error: No switch named '%s'.\n", argv[1]);
+        return;
+    }
+
+    if (sw == current_switch) {
+        current_switch = NULL;
+    }
+    switch_stop(sw);
+    printf("Switch '%s' deleted\n", argv[1]);
+}
+
+static void cmd_use(int argc, char **argv) {
+    if (argc != 2) {
+        printf("Usage: use <name>\n");
+        return;
+    }
+
+    switch_t *sw = switch_find(argv[1]);
+    if (sw == NULL) {
+        printf("Error: No switch named '%s'.\n", argv[1]);
+        return;
+    }
+
+    current_switch = sw;
+}
+
+static void cmd_list(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    switch_list();
 }
 
 /* ---------------- Helper Functions ---------------- */
+static switch_t *selected_switch(void) {
+    if (current_switch == NULL) {
+        printf("Error: No switch selected. Use 'create <name>' or 'use <name>' first.\n");
+    }
+    return current_switch;
+}
+
+static int parse_mac(const char *str, unsigned char *mac) {
+    unsigned int bytes[MAC_ADDR_LEN];
+    char trailing;
+
+    if (sscanf(str, "%x:%x:%x:%x:%x:%x%c", &bytes[0], &bytes[1], &bytes[2],
+               &bytes[3], &bytes[4], &bytes[5], &trailing) != MAC_ADDR_LEN) {
+        return -1;
+    }
+
+    for (int i = 0; i < MAC_ADDR_LEN; i++) {
+        if (bytes[i] > 0xff) {
+            return -1;
+        }
+        mac[i] = (unsigned char)bytes[i];
+    }
+    return 0;
+}
+
+static int parse_ip_prefix(const char *str, uint8_t *ip, uint8_t *mask) {
+    char addr[INET6_ADDRSTRLEN];
+    const char *slash = strchr(str, '/');
+    size_t addr_len = slash != NULL ? (size_t)(slash - str) : strlen(str);
+    int bits;
+
+    if (addr_len >= sizeof(addr)) {
+        return -1;
+    }
+    memcpy(addr, str, addr_len);
+    addr[addr_len] = '\0';
+
+    memset(ip, 0, 16);
+    memset(mask, 0, 16);
+    if (inet_pton(AF_INET, addr, ip + 12) == 1) {
+        // IPv4-mapped, the ::ffff: part always has to match
+        ip[10] = ip[11] = 0xff;
+        bits = slash != NULL ? atoi(slash + 1) : 32;
+        if (bits < 0 || bits > 32) {
+            return -1;
+        }
+        bits += 96;
+    } else if (inet_pton(AF_INET6, addr, ip) == 1) {
+        bits = slash != NULL ? atoi(slash + 1) : 128;
+        if (bits < 0 || bits > 128) {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+
+    for (int i = 0; i < 16; i++) {
+        int byte_bits = bits - i * 8;
+        mask[i] = byte_bits >= 8 ? 0xff : byte_bits <= 0 ? 0 : (uint8_t)(0xff << (8 - byte_bits));
+        ip[i] &= mask[i];
+    }
+    return 0;
+}
+
+static int parse_acl_rule(int argc, char **argv, acl_rule_t *rule) {
+    int i = 0;
+
+    memset(rule, 0, sizeof(*rule));
+    if (argc < 2) {
+        printf("Usage: acl <port> add <prio> <action> [match...]\n");
+        return -1;
+    }
+    rule->priority = atoi(argv[i++]);
+
+    const char *action = argv[i++];
+    if (strcmp(action, "permit") == 0) {
+        rule->action = ACL_PERMIT;
+    } else if (strcmp(action, "deny") == 0) {
+        rule->action = ACL_DENY;
+    } else if (strcmp(action, "mirror") == 0 && i < argc) {
+        rule->action = ACL_MIRROR;
+        rule->mirror_port = atoi(argv[i++]) - 1; // Convert from 1-based to 0-based
+    } else if (strcmp(action, "rate-limit") == 0 && i + 1 < argc) {
+        rule->action = ACL_RATE_LIMIT;
+        rule->rate_pps = (uint32_t)strtoul(argv[i++], NULL, 0);
+        rule->burst = (uint32_t)strtoul(argv[i++], NULL, 0);
+    } else {
+        printf("Error: Invalid action '%s'. Use permit, deny, mirror <port> or rate-limit <pps> <burst>.\n", action);
+        return -1;
+    }
+
+    // Match fields come in "<field> <value>" pairs, unset fields are wildcards
+    for (; i < argc; i += 2) {
+        const char *field = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        acl_key_t *key = &rule->key;
+        acl_key_t *mask = &rule->mask;
+        int ok = value != NULL;
+
+        if (!ok) {
+            // Missing value, reported below
+        } else if (strcmp(field, "src-mac") == 0) {
+            ok = parse_mac(value, key->f.src_mac) == 0;
+            memset(mask->f.src_mac, 0xff, sizeof(mask->f.src_mac));
+        } else if (strcmp(field, "dst-mac") == 0) {
+            ok = parse_mac(value, key->f.dst_mac) == 0;
+            memset(mask->f.dst_mac, 0xff, sizeof(mask->f.dst_mac));
+        } else if (strcmp(field, "ethertype") == 0) {
+            key->f.ethertype = (uint16_t)strtoul(value, NULL, 0);
+            mask->f.ethertype = 0xffff;
+        } else if (strcmp(field, "vlan") == 0) {
+            int vid = atoi(value);
+            ok = vid >= 0 && vid < 4096;
+            key->f.vlan = ACL_VLAN_TAGGED | (uint16_t)vid;
+            mask->f.vlan = ACL_VLAN_TAGGED | 0x0fff;
+        } else if (strcmp(field, "proto") == 0) {
+            if (strcmp(value, "tcp") == 0) {
+                key->f.ip_proto = 6;
+            } else if (strcmp(value, "udp") == 0) {
+                key->f.ip_proto = 17;
+            } else if (strcmp(value, "icmp") == 0) {
+                key->f.ip_proto = 1;
+            } else {
+                key->f.ip_proto = (uint8_t)atoi(value);
+            }
+            mask->f.ip_proto = 0xff;
+        } else if (strcmp(field, "src-ip") == 0) {
+            ok = parse_ip_prefix(value, key->f.src_ip, mask->f.src_ip) == 0;
+        } else if (strcmp(field, "dst-ip") == 0) {
+            ok = parse_ip_prefix(value, key->f.dst_ip, mask->f.dst_ip) == 0;
+        } else if (strcmp(field, "src-port") == 0) {
+            key->f.src_port = (uint16_t)atoi(value);
+            mask->f.src_port = 0xffff;
+        } else if (strcmp(field, "dst-port") == 0) {
+            key->f.dst_port = (uint16_t)atoi(value);
+            mask->f.dst_port = 0xffff;
+        } else {
+            printf("Error: Unknown match field '%s'.\n", field);
+            return -1;
+        }
+
+        if (!ok) {
+            printf("Error: Invalid or missing value for '%s'.\n", field);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int execute_line(char *line) {
+    char *argv[MAX_ARGS];
+
+    if (strcmp(line, "exit") == 0) {
+        return 1;
+    }
+
+    int argc = parse_args(line, argv, MAX_ARGS);
+    if (argc == 0) {
+        return 0;
+    }
+
+    cli_command_t *cmd = find_command(argv[0]);
+    if (cmd != NULL) {
+        cmd->handler(argc, argv);
+    } else {
+        printf("Unknown command: %s. Type 'help' for available commands.\n", argv[0]);
+    }
+    return 0;
+}
+
 static int parse_args(char *line, char **argv, int max_args) {
     int argc = 0;
     char *token = strtok(line, " \t");
@@ -169,12 +704,48 @@ static cli_command_t *find_command(const char *name) {
 /*------------------------------------------------------------------------------
  * Public Functions
  *----------------------------------------------------------------------------*/
-void cli_run(void) {
+int cli_run_file(const char *path, switch_t *initial_switch) {
     char cmd_buffer[CMD_BUFFER_SIZE];
-    char *argv[MAX_ARGS];
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Opening config file failed");
+        return -1;
+    }
+
+    current_switch = initial_switch;
+    defer_acl_commits = true;
+
+    while (fgets(cmd_buffer, sizeof(cmd_buffer), file) != NULL) {
+        cmd_buffer[strcspn(cmd_buffer, "\n")] = '\0';
+
+        // Skip empty lines and comments
+        if (cmd_buffer[0] == '\0' || cmd_buffer[0] == '#') {
+            continue;
+        }
+
+        if (execute_line(cmd_buffer)) {
+            break;
+        }
+    }
+
+    fclose(file);
+
+    // One compile per port for the whole file instead of one per rule
+    defer_acl_commits = false;
+    if (switch_acl_commit_all() < 0) {
+        printf("Error: Cannot compile the ACLs, the previous rules stay in place.\n");
+    }
+    return 0;
+}
+
+void cli_run(switch_t *initial_switch) {
+    char cmd_buffer[CMD_BUFFER_SIZE];
+
+    current_switch = initial_switch;
 
     while (1) {
-        printf("Switch> ");
+        printf("Switch(%s)> ", current_switch ? switch_name(current_switch) : "-");
         if (fgets(cmd_buffer, sizeof(cmd_buffer), stdin) == NULL) {
             break;
         }
@@ -187,20 +758,8 @@ void cli_run(void) {
             continue;
         }
 
-        if (strcmp(cmd_buffer, "exit") == 0) {
+        if (execute_line(cmd_buffer)) {
             break;
         }
-
-        int argc = parse_args(cmd_buffer, argv, MAX_ARGS);
-        if (argc == 0) {
-            continue;
-        }
-
-        cli_command_t *cmd = find_command(argv[0]);
-        if (cmd != NULL) {
-            cmd->handler(argc, argv);
-        } else {
-            printf("Unknown command: %s. Type 'help' for available commands.\n", argv[0]);
-        }
     }
 }
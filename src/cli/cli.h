@@ -1,10 +1,24 @@
 #ifndef CLI_H
 #define CLI_H
 
+#include "switch/switch.h"
+
 /**
  * @brief Run the CLI input loop.
  *        Blocks until the user types "exit" or EOF.
+ *
+ * @param initial_switch The switch instance selected at startup (may be NULL)
+ */
+void cli_run(switch_t *initial_switch);
+
+/**
+ * @brief Run the commands of a config file, one per line ('#' starts a comment line).
+ *        ACL changes are compiled and swapped in once, after the last line.
+ *
+ * @param path Path of the config file
+ * @param initial_switch The switch instance selected before the first command (may be NULL)
+ * @return 0 on success, -1 if the file cannot be opened
  */
-void cli_run(void);
+int cli_run_file(const char *path, switch_t *initial_switch);
 
 #endif // CLI_H
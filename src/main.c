@@ -1,18 +1,86 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "switch/switch.h"
 #include "cli/cli.h"
 
-int main(void) {
-    printf("Starting Simple Switch on %d ports...\n", MAX_PORTS);
+#define DEFAULT_WORKERS 1
+#define DEFAULT_SWITCH_NAME "default"
+#define DEFAULT_SNAPSHOT_INTERVAL_S 30
 
-    switch_init();
-    switch_start();
+static void usage(const char *prog) {
+    printf("Usage: %s [-c config] [-s snapshot_dir] [-i snapshot_interval_s] [workers] [poll|uring]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *config_path = NULL;
+    const char *snapshot_dir = NULL;
+    int snapshot_interval_s = DEFAULT_SNAPSHOT_INTERVAL_S;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:s:i:h")) != -1) {
+        switch (opt) {
+        case 'c':
+            config_path = optarg;
+            break;
+        case 's':
+            snapshot_dir = optarg;
+            break;
+        case 'i':
+            snapshot_interval_s = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    // Optional arguments: number of worker threads shared by all switches, port backend
+    int workers = (optind < argc) ? atoi(argv[optind]) : DEFAULT_WORKERS;
+    switch_backend_t backend = (optind + 1 < argc && strcmp(argv[optind + 1], "uring") == 0) ? SWITCH_BACKEND_URING : SWITCH_BACKEND_POLL;
+
+    printf("Starting Simple Switch with %d %s worker(s), %d ports per switch...\n",
+           workers, backend == SWITCH_BACKEND_URING ? "io_uring" : "poll", MAX_PORTS);
+
+    if (switch_system_init(workers, backend) < 0) {
+        printf("Failed to initialize the switch (workers must be 1-%d).\n", MAX_WORKERS);
+        return 1;
+    }
+
+    // Before creating instances, so they warm-start from their last snapshot
+    if (snapshot_dir != NULL && switch_enable_snapshots(snapshot_dir, snapshot_interval_s) < 0) {
+        printf("Failed to enable MAC table snapshots in %s.\n", snapshot_dir);
+        switch_system_shutdown();
+        return 1;
+    }
+
+    switch_t *sw = switch_init(DEFAULT_SWITCH_NAME);
+    if (sw == NULL) {
+        printf("Failed to create the %s switch.\n", DEFAULT_SWITCH_NAME);
+        switch_system_shutdown();
+        return 1;
+    }
+
+    // Configure before starting, so static entries go straight into the MAC table
+    if (config_path != NULL && cli_run_file(config_path, sw) < 0) {
+        switch_system_shutdown();
+        return 1;
+    }
+
+    // The config file may have deleted the default instance
+    sw = switch_find(DEFAULT_SWITCH_NAME);
+    if (sw != NULL && switch_start(sw) < 0) {
+        printf("Failed to start the %s switch.\n", DEFAULT_SWITCH_NAME);
+        switch_system_shutdown();
+        return 1;
+    }
 
-    cli_run(); // Blocks until "exit" or EOF
+    cli_run(sw); // Blocks until "exit" or EOF
 
     printf("Exiting...\n");
-    switch_stop();
+    switch_system_shutdown();
 
     return 0;
 }
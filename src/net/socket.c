@@ -8,6 +8,7 @@
 #include <linux/if_packet.h>
 #include <net/ethernet.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 #include "socket.h"
 
@@ -68,3 +69,93 @@ int create_socket(const char *iface_name) {
 void socket_close(int sock_fd) {
     close(sock_fd);
 }
+
+int socket_set_busy_poll(int sock_fd, int busy_poll_us) {
+    /* SO_BUSY_POLL makes the kernel spin on the device queue for up to
+     * busy_poll_us instead of waiting for an interrupt. Raising it above the
+     * sysctl default needs CAP_NET_ADMIN, which we already have as root.
+     */
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)) < 0) {
+        perror("Busy poll failed");
+        return -1;
+    }
+
+#ifdef SO_PREFER_BUSY_POLL
+    /* Ask the driver to defer its own IRQ processing while we are polling.
+     * Only available on kernels >= 5.11, so a failure here is not fatal.
+     */
+    int prefer = busy_poll_us > 0 ? 1 : 0;
+    setsockopt(sock_fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+#endif
+
+    return 0;
+}
+
+int socket_enable_rx_timestamps(int sock_fd) {
+    int enable = 1;
+
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+        perror("RX timestamps failed");
+        return -1;
+    }
+
+    return 0;
+}
+
+int socket_enable_vlan_info(int sock_fd) {
+    int enable = 1;
+
+    /* The kernel pulls the outer 802.1Q/802.1ad tag out of the frame before
+     * packet sockets see it. PACKET_AUXDATA is the only way to get it back.
+     */
+    if (setsockopt(sock_fd, SOL_PACKET, PACKET_AUXDATA, &enable, sizeof(enable)) < 0) {
+        perror("VLAN auxdata failed");
+        return -1;
+    }
+
+    return 0;
+}
+
+ssize_t socket_recv_frame(int sock_fd, void *buf, size_t len, struct timespec *rx_ts, int32_t *vlan_tci) {
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    // Ancillary data buffer, aligned for struct cmsghdr
+    union {
+        char buf[SOCKET_RX_CONTROL_LEN];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+
+    memset(rx_ts, 0, sizeof(*rx_ts));
+    *vlan_tci = -1;
+
+    ssize_t ret = recvmsg(sock_fd, &msg, MSG_DONTWAIT);
+    if (ret < 0) {
+        return ret;
+    }
+
+    socket_parse_rx_info(&msg, rx_ts, vlan_tci);
+    return ret;
+}
+
+void socket_parse_rx_info(struct msghdr *msg, struct timespec *rx_ts, int32_t *vlan_tci) {
+    memset(rx_ts, 0, sizeof(*rx_ts));
+    *vlan_tci = -1;
+
+    // Both arrive as control messages next to the frame
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(rx_ts, CMSG_DATA(cmsg), sizeof(*rx_ts));
+        } else if (cmsg->cmsg_level == SOL_PACKET && cmsg->cmsg_type == PACKET_AUXDATA) {
+            struct tpacket_auxdata aux;
+            memcpy(&aux, CMSG_DATA(cmsg), sizeof(aux));
+            if (aux.tp_status & TP_STATUS_VLAN_VALID) {
+                *vlan_tci = aux.tp_vlan_tci;
+            }
+        }
+    }
+}
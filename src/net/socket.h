@@ -1,9 +1,37 @@
 #ifndef SOCKET_H
 #define SOCKET_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+// Room for the control messages socket_parse_rx_info() understands
+#define SOCKET_RX_CONTROL_LEN (CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(struct tpacket_auxdata)))
+
 // Helper to create a raw socket and bind it to a specific interface
 int create_socket(const char *iface_name);
 
 void socket_close(int sock_fd);
 
+// Enable (busy_poll_us > 0) or disable (0) kernel busy polling on a socket
+int socket_set_busy_poll(int sock_fd, int busy_poll_us);
+
+// Ask the kernel to stamp every received frame (SO_TIMESTAMPNS)
+int socket_enable_rx_timestamps(int sock_fd);
+
+// Ask the kernel for the 802.1Q tag it strips from received frames (PACKET_AUXDATA)
+int socket_enable_vlan_info(int sock_fd);
+
+// Receive a frame with its kernel RX timestamp (zeroed if the kernel gave none)
+// and the TCI of the VLAN tag the kernel stripped from it (-1 if untagged).
+// Never blocks: returns -1 with errno EAGAIN when the socket queue is empty.
+ssize_t socket_recv_frame(int sock_fd, void *buf, size_t len, struct timespec *rx_ts, int32_t *vlan_tci);
+
+// Extract the SO_TIMESTAMPNS timestamp (zeroed if absent) and the stripped
+// VLAN TCI (-1 if none) from received control data
+void socket_parse_rx_info(struct msghdr *msg, struct timespec *rx_ts, int32_t *vlan_tci);
+
 #endif // SOCKET_H
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+/*------------------------------------------------------------------------------
+ * Static Function Declarations
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief io_uring_setup(2) wrapper.
+ *
+ * @param entries Number of SQ entries
+ * @param params Ring parameters, filled in by the kernel
+ * @return The ring file descriptor, or -1 with errno set
+ */
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params);
+
+/**
+ * @brief io_uring_enter(2) wrapper.
+ *
+ * @param fd The ring file descriptor
+ * @param to_submit Number of SQEs to submit
+ * @param min_complete Number of completions to wait for
+ * @param flags IORING_ENTER_* flags
+ * @param arg Extended argument (struct io_uring_getevents_arg) or NULL
+ * @param arg_size Size of arg
+ * @return Number of SQEs submitted, or -1 with errno set
+ */
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              void *arg, size_t arg_size);
+
+/**
+ * @brief io_uring_register(2) wrapper.
+ *
+ * @param fd The ring file descriptor
+ * @param opcode IORING_REGISTER_* opcode
+ * @param arg Opcode specific argument
+ * @param nr_args Number of arguments
+ * @return 0 on success, -1 with errno set
+ */
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args);
+
+/*------------------------------------------------------------------------------
+ * Static Functions
+ *----------------------------------------------------------------------------*/
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              void *arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/*------------------------------------------------------------------------------
+ * Public Functions
+ *----------------------------------------------------------------------------*/
+int uring_init(uring_t *ring, unsigned entries) {
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    /* Only the owning worker ever submits, let the kernel skip the locking for
+     * that. SUBMIT_ALL keeps the kernel going past a bad SQE, so one submit
+     * always empties the SQ.
+     */
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_SUBMIT_ALL;
+
+    ring->fd = sys_io_uring_setup(entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    // The SQ and CQ rings share one mapping on all kernels we support (>= 5.4)
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->sq_ring_ptr = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    ring->cq_ring_ptr = ring->sq_ring_ptr;
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    char *sq = ring->sq_ring_ptr;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    char *cq = ring->cq_ring_ptr;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return 0;
+}
+
+void uring_exit(uring_t *ring) {
+    if (ring->buf_ring != NULL) {
+        munmap(ring->buf_ring, ring->buf_ring_size);
+    }
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+struct io_uring_sqe *uring_get_sqe(uring_t *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned mask = *ring->sq_mask;
+
+    if (ring->sq_local_tail - head > mask) {
+        return NULL; // Full
+    }
+
+    unsigned index = ring->sq_local_tail & mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr, int timeout_ms) {
+    unsigned to_submit = ring->sq_local_tail - *ring->sq_tail;
+    unsigned flags = 0;
+
+    // Publish the new SQEs to the kernel
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    if (to_submit == 0 && wait_nr == 0) {
+        return 0; // Nothing to do, completions can be reaped without a syscall
+    }
+
+    struct __kernel_timespec ts = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_nsec = (long long)(timeout_ms % 1000) * 1000000,
+    };
+    struct io_uring_getevents_arg arg = {
+        .ts = (uint64_t)(uintptr_t)&ts,
+    };
+
+    if (wait_nr > 0) {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    }
+
+    int ret = sys_io_uring_enter(ring->fd, to_submit, wait_nr, flags,
+                                 wait_nr > 0 ? &arg : NULL, wait_nr > 0 ? sizeof(arg) : 0);
+    if (ret < 0 && errno == EINTR) {
+        return 0;
+    }
+    return ret;
+}
+
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring) {
+    unsigned head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+void uring_cqe_seen(uring_t *ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+int uring_setup_buf_ring(uring_t *ring, unsigned entries, uint16_t bgid) {
+    ring->buf_ring_size = entries * sizeof(struct io_uring_buf);
+    ring->buf_ring = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (ring->buf_ring == MAP_FAILED) {
+        ring->buf_ring = NULL;
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = entries;
+    reg.bgid = bgid;
+
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring->buf_ring, ring->buf_ring_size);
+        ring->buf_ring = NULL;
+        return -1;
+    }
+
+    ring->buf_ring_mask = entries - 1;
+    ring->buf_ring_tail = 0;
+    return 0;
+}
+
+void uring_buf_ring_add(uring_t *ring, void *addr, unsigned len, uint16_t bid) {
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_ring_tail & ring->buf_ring_mask];
+
+    buf->addr = (uint64_t)(uintptr_t)addr;
+    buf->len = len;
+    buf->bid = bid;
+    ring->buf_ring_tail++;
+}
+
+void uring_buf_ring_publish(uring_t *ring) {
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_ring_tail, __ATOMIC_RELEASE);
+}
+
+void uring_prep_recvmsg_multishot(struct io_uring_sqe *sqe, int fd, struct msghdr *msg,
+                                  uint16_t bgid, uint64_t user_data) {
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bgid;
+    sqe->user_data = user_data;
+}
+
+void uring_prep_send(struct io_uring_sqe *sqe, int fd, const void *buf, size_t len, uint64_t user_data) {
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->user_data = user_data;
+}
+
+void uring_prep_cancel(struct io_uring_sqe *sqe, uint64_t target_user_data, uint64_t user_data) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target_user_data;
+    sqe->user_data = user_data;
+}
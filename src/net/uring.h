@@ -0,0 +1,77 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+/* Minimal io_uring wrapper on top of the raw syscalls (no liburing needed).
+ * A ring is owned by one thread, none of these functions are thread-safe.
+ */
+typedef struct uring_st {
+    int fd;
+
+    // Submission queue (shared with the kernel)
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sq_local_tail; // SQEs handed out but not yet published to the kernel
+
+    // Completion queue (shared with the kernel)
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring_ptr;
+    size_t sq_ring_size;
+    void *cq_ring_ptr;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    // Provided buffer ring (optional)
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    unsigned buf_ring_mask;
+    uint16_t buf_ring_tail;
+} uring_t;
+
+// Create a ring with the given number of SQ entries. Returns 0, or -1 with errno set
+int uring_init(uring_t *ring, unsigned entries);
+
+void uring_exit(uring_t *ring);
+
+// Get a free SQE (zeroed), or NULL if the submission queue is full
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+
+// Submit all pending SQEs and wait for wait_nr completions or timeout_ms.
+// Returns the number of SQEs submitted, or -1 with errno set (ETIME on timeout)
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr, int timeout_ms);
+
+// Get the next completion, or NULL if there is none. Call uring_cqe_seen() when done with it
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring);
+
+void uring_cqe_seen(uring_t *ring);
+
+// Register a provided buffer ring (entries must be a power of two) as buffer group bgid
+int uring_setup_buf_ring(uring_t *ring, unsigned entries, uint16_t bgid);
+
+// Hand a buffer to the kernel. Buffers become visible on uring_buf_ring_publish()
+void uring_buf_ring_add(uring_t *ring, void *addr, unsigned len, uint16_t bid);
+
+void uring_buf_ring_publish(uring_t *ring);
+
+// Multishot recvmsg picking buffers from group bgid. Each completion's buffer starts
+// with a struct io_uring_recvmsg_out, then the name, the control data and the payload
+void uring_prep_recvmsg_multishot(struct io_uring_sqe *sqe, int fd, struct msghdr *msg,
+                                  uint16_t bgid, uint64_t user_data);
+
+void uring_prep_send(struct io_uring_sqe *sqe, int fd, const void *buf, size_t len, uint64_t user_data);
+
+// Cancel the request(s) submitted with target_user_data
+void uring_prep_cancel(struct io_uring_sqe *sqe, uint64_t target_user_data, uint64_t user_data);
+
+#endif // URING_H
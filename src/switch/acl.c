@@ -0,0 +1,638 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "acl.h"
+
+/*------------------------------------------------------------------------------
+ * Definitions
+ *----------------------------------------------------------------------------*/
+#define ETH_HEADER_LEN 14
+#define ETH_TYPE_IPV4 0x0800
+#define ETH_TYPE_IPV6 0x86dd
+#define ETH_TYPE_VLAN 0x8100
+#define ETH_TYPE_QINQ 0x88a8
+
+#define IPV4_HEADER_LEN 20
+#define IPV6_HEADER_LEN 40
+#define IPV6_MAX_EXT_HEADERS 8 // Give up on the upper-layer header after this many extension headers
+
+#define IP_PROTO_HOPOPTS 0
+#define IP_PROTO_TCP 6
+#define IP_PROTO_UDP 17
+#define IP_PROTO_ROUTING 43
+#define IP_PROTO_FRAGMENT 44
+#define IP_PROTO_AH 51
+#define IP_PROTO_DSTOPTS 60
+#define IP_PROTO_SCTP 132
+
+/*------------------------------------------------------------------------------
+ * Types
+ *----------------------------------------------------------------------------*/
+/* A rule as the lookup sees it: key already masked, rate limit precomputed. */
+typedef struct acl_entry_st {
+    acl_key_t key;
+    int priority;
+    int id;
+    acl_action_t action;
+    int mirror_port;
+    uint64_t interval_ns;  // ACL_RATE_LIMIT: time one frame uses up
+    uint64_t tolerance_ns; // ACL_RATE_LIMIT: how far ahead of the sustained rate a burst may run
+    acl_counter_t *counter;
+} acl_entry_t;
+
+/* All the rules sharing one mask (a "tuple"). Open addressing, linear probing. */
+typedef struct acl_group_st {
+    acl_key_t mask;
+    int max_priority;  // Highest priority in the group, lets the lookup stop early
+    int count;
+    uint32_t hash_mask;
+    uint32_t *buckets; // Entry index + 1, 0 = empty
+} acl_group_t;
+
+struct acl_classifier_st {
+    acl_entry_t *entries;
+    int num_entries;
+    acl_group_t *groups; // Sorted by max_priority, highest first
+    int num_groups;
+};
+
+/*------------------------------------------------------------------------------
+ * Static Function Declarations
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief Read a big-endian 16-bit value.
+ *
+ * @param p Pointer to the value
+ * @return The value in host byte order
+ */
+static uint16_t read_be16(const uint8_t *p);
+
+/**
+ * @brief Extract the lookup key of a frame. Fields the frame does not have stay zero.
+ *
+ * @param frame The Ethernet frame
+ * @param len Length of the frame
+ * @param vlan_tci TCI of the VLAN tag the kernel stripped from the frame, -1 if untagged
+ * @param key The key
+ */
+static void extract_key(const uint8_t *frame, size_t len, int32_t vlan_tci, acl_key_t *key);
+
+/**
+ * @brief Fill the IPv4 fields of a key.
+ *
+ * @param l3 Start of the IPv4 header
+ * @param len Bytes available from l3
+ * @param key The key
+ */
+static void extract_ipv4(const uint8_t *l3, size_t len, acl_key_t *key);
+
+/**
+ * @brief Fill the IPv6 fields of a key, skipping the extension headers.
+ *
+ * @param l3 Start of the IPv6 header
+ * @param len Bytes available from l3
+ * @param key The key
+ */
+static void extract_ipv6(const uint8_t *l3, size_t len, acl_key_t *key);
+
+/**
+ * @brief Fill the port fields of a key for protocols that have them.
+ *
+ * @param l4 Start of the transport header
+ * @param len Bytes available from l4
+ * @param key The key, with ip_proto already set
+ */
+static void extract_ports(const uint8_t *l4, size_t len, acl_key_t *key);
+
+/**
+ * @brief Apply a mask to a key.
+ *
+ * @param key The key
+ * @param mask The mask
+ * @param out The masked key
+ */
+static void mask_key(const acl_key_t *key, const acl_key_t *mask, acl_key_t *out);
+
+/**
+ * @brief Compare two keys.
+ *
+ * @param a First key
+ * @param b Second key
+ * @return true if equal
+ */
+static bool keys_equal(const acl_key_t *a, const acl_key_t *b);
+
+/**
+ * @brief Hash a (masked) key.
+ *
+ * @param key The key
+ * @return The hash
+ */
+static uint32_t hash_key(const acl_key_t *key);
+
+/**
+ * @brief qsort() comparator: higher priority first, then lower id first.
+ *
+ * @param a First entry
+ * @param b Second entry
+ * @return Comparison result
+ */
+static int compare_entries(const void *a, const void *b);
+
+/**
+ * @brief Check whether the rate limit lets a frame through, and account for it.
+ *
+ * @param entry The matching rate-limit entry
+ * @return true if the frame conforms to the rate
+ */
+static bool rate_limit_allows(const acl_entry_t *entry);
+
+/**
+ * @brief Count the leading one bits of a mask.
+ *
+ * @param mask The mask
+ * @param len Length of the mask in bytes
+ * @return The prefix length in bits
+ */
+static int prefix_length(const uint8_t *mask, int len);
+
+/**
+ * @brief Print the match fields of a rule, e.g. "ethertype 0x0800 dst-port 80".
+ *
+ * @param rule The rule
+ */
+static void print_match(const acl_rule_t *rule);
+
+/**
+ * @brief Print an IP prefix of a rule, in IPv4 notation if it is IPv4-mapped.
+ *
+ * @param name Field name
+ * @param ip The address
+ * @param mask The mask
+ */
+static void print_ip_match(const char *name, const uint8_t *ip, const uint8_t *mask);
+
+/*------------------------------------------------------------------------------
+ * Static Functions Definitions
+ *----------------------------------------------------------------------------*/
+static uint16_t read_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void extract_key(const uint8_t *frame, size_t len, int32_t vlan_tci, acl_key_t *key) {
+    memset(key, 0, sizeof(*key));
+    if (len < ETH_HEADER_LEN) {
+        return;
+    }
+
+    memcpy(key->f.dst_mac, frame, sizeof(key->f.dst_mac));
+    memcpy(key->f.src_mac, frame + 6, sizeof(key->f.src_mac));
+
+    size_t offset = 12;
+    uint16_t ethertype = read_be16(frame + offset);
+    offset += 2;
+
+    /* The kernel strips the outer tag before packet sockets see the frame, so
+     * it comes from the auxdata. A tag still in the data is the inner one of a
+     * QinQ frame: only skipped, so the ethertype is the one behind it.
+     */
+    if (vlan_tci >= 0) {
+        key->f.vlan = ACL_VLAN_TAGGED | ((uint16_t)vlan_tci & 0x0fff);
+    }
+    if ((ethertype == ETH_TYPE_VLAN || ethertype == ETH_TYPE_QINQ) && len >= offset + 4) {
+        ethertype = read_be16(frame + offset + 2);
+        offset += 4;
+    }
+    key->f.ethertype = ethertype;
+
+    if (ethertype == ETH_TYPE_IPV4) {
+        extract_ipv4(frame + offset, len - offset, key);
+    } else if (ethertype == ETH_TYPE_IPV6) {
+        extract_ipv6(frame + offset, len - offset, key);
+    }
+}
+
+static void extract_ipv4(const uint8_t *l3, size_t len, acl_key_t *key) {
+    if (len < IPV4_HEADER_LEN) {
+        return;
+    }
+    size_t header_len = (size_t)(l3[0] & 0x0f) * 4;
+    if (header_len < IPV4_HEADER_LEN || header_len > len) {
+        return;
+    }
+
+    key->f.ip_proto = l3[9];
+
+    // IPv4-mapped: ::ffff:a.b.c.d
+    key->f.src_ip[10] = key->f.src_ip[11] = 0xff;
+    key->f.dst_ip[10] = key->f.dst_ip[11] = 0xff;
+    memcpy(&key->f.src_ip[12], l3 + 12, 4);
+    memcpy(&key->f.dst_ip[12], l3 + 16, 4);
+
+    // Only the first fragment carries the ports
+    if ((read_be16(l3 + 6) & 0x1fff) == 0) {
+        extract_ports(l3 + header_len, len - header_len, key);
+    }
+}
+
+static void extract_ipv6(const uint8_t *l3, size_t len, acl_key_t *key) {
+    if (len < IPV6_HEADER_LEN) {
+        return;
+    }
+
+    memcpy(key->f.src_ip, l3 + 8, 16);
+    memcpy(key->f.dst_ip, l3 + 24, 16);
+
+    uint8_t next_header = l3[6];
+    size_t offset = IPV6_HEADER_LEN;
+    bool first_fragment = true;
+
+    for (int i = 0; i < IPV6_MAX_EXT_HEADERS; i++) {
+        const uint8_t *ext = l3 + offset;
+        size_t ext_len;
+
+        if (next_header == IP_PROTO_HOPOPTS || next_header == IP_PROTO_ROUTING || next_header == IP_PROTO_DSTOPTS) {
+            if (len < offset + 8) {
+                return;
+            }
+            ext_len = ((size_t)ext[1] + 1) * 8;
+        } else if (next_header == IP_PROTO_FRAGMENT) {
+            if (len < offset + 8) {
+                return;
+            }
+            ext_len = 8;
+            first_fragment = (read_be16(ext + 2) & 0xfff8) == 0;
+        } else if (next_header == IP_PROTO_AH) {
+            if (len < offset + 8) {
+                return;
+            }
+            ext_len = ((size_t)ext[1] + 2) * 4;
+        } else {
+            break; // Upper-layer header
+        }
+
+        next_header = ext[0];
+        offset += ext_len;
+    }
+
+    key->f.ip_proto = next_header;
+    if (first_fragment && offset <= len) {
+        extract_ports(l3 + offset, len - offset, key);
+    }
+}
+
+static void extract_ports(const uint8_t *l4, size_t len, acl_key_t *key) {
+    uint8_t proto = key->f.ip_proto;
+
+    if ((proto == IP_PROTO_TCP || proto == IP_PROTO_UDP || proto == IP_PROTO_SCTP) && len >= 4) {
+        key->f.src_port = read_be16(l4);
+        key->f.dst_port = read_be16(l4 + 2);
+    }
+}
+
+static void mask_key(const acl_key_t *key, const acl_key_t *mask, acl_key_t *out) {
+    for (int i = 0; i < ACL_KEY_WORDS; i++) {
+        out->words[i] = key->words[i] & mask->words[i];
+    }
+}
+
+static bool keys_equal(const acl_key_t *a, const acl_key_t *b) {
+    uint64_t diff = 0;
+    for (int i = 0; i < ACL_KEY_WORDS; i++) {
+        diff |= a->words[i] ^ b->words[i];
+    }
+    return diff == 0;
+}
+
+static uint32_t hash_key(const acl_key_t *key) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < ACL_KEY_WORDS; i++) {
+        hash = (hash ^ key->words[i]) * 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+    return (uint32_t)hash;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const acl_entry_t *ea = a;
+    const acl_entry_t *eb = b;
+
+    if (ea->priority != eb->priority) {
+        return ea->priority > eb->priority ? -1 : 1;
+    }
+    return ea->id - eb->id;
+}
+
+static bool rate_limit_allows(const acl_entry_t *entry) {
+    acl_counter_t *counter = entry->counter;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+    /* GCRA: each frame pushes the theoretical arrival time one interval
+     * ahead. A frame is over the rate when that time has run further ahead
+     * of now than the burst allows. tat_ns is only touched by the Switch
+     * Engine serving the port.
+     */
+    uint64_t tat = counter->tat_ns > now ? counter->tat_ns : now;
+    if (tat - now > entry->tolerance_ns) {
+        __atomic_fetch_add(&counter->limited, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    counter->tat_ns = tat + entry->interval_ns;
+    return true;
+}
+
+static int prefix_length(const uint8_t *mask, int len) {
+    int bits = 0;
+    for (int i = 0; i < len; i++) {
+        if (mask[i] != 0xff) {
+            return bits + __builtin_clz((unsigned)(uint8_t)~mask[i]) - 24;
+        }
+        bits += 8;
+    }
+    return bits;
+}
+
+static void print_ip_match(const char *name, const uint8_t *ip, const uint8_t *mask) {
+    static const uint8_t v4_mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    char str[INET6_ADDRSTRLEN];
+    int bits = prefix_length(mask, 16);
+
+    if (bits == 0) {
+        return;
+    }
+    if (bits >= 96 && memcmp(ip, v4_mapped, sizeof(v4_mapped)) == 0) {
+        inet_ntop(AF_INET, ip + 12, str, sizeof(str));
+        printf(" %s %s/%d", name, str, bits - 96);
+    } else {
+        inet_ntop(AF_INET6, ip, str, sizeof(str));
+        printf(" %s %s/%d", name, str, bits);
+    }
+}
+
+static void print_match(const acl_rule_t *rule) {
+    const acl_key_t *key = &rule->key;
+    const acl_key_t *mask = &rule->mask;
+    static const acl_key_t none;
+
+    if (keys_equal(mask, &none)) {
+        printf(" any");
+        return;
+    }
+
+    if (mask->f.src_mac[0] != 0) {
+        const uint8_t *m = key->f.src_mac;
+        printf(" src-mac %02x:%02x:%02x:%02x:%02x:%02x", m[0], m[1], m[2], m[3], m[4], m[5]);
+    }
+    if (mask->f.dst_mac[0] != 0) {
+        const uint8_t *m = key->f.dst_mac;
+        printf(" dst-mac %02x:%02x:%02x:%02x:%02x:%02x", m[0], m[1], m[2], m[3], m[4], m[5]);
+    }
+    if (mask->f.ethertype != 0) {
+        printf(" ethertype 0x%04x", key->f.ethertype);
+    }
+    if (mask->f.vlan != 0) {
+        printf(" vlan %d", key->f.vlan & 0x0fff);
+    }
+    if (mask->f.ip_proto != 0) {
+        printf(" proto %d", key->f.ip_proto);
+    }
+    print_ip_match("src-ip", key->f.src_ip, mask->f.src_ip);
+    print_ip_match("dst-ip", key->f.dst_ip, mask->f.dst_ip);
+    if (mask->f.src_port != 0) {
+        printf(" src-port %d", key->f.src_port);
+    }
+    if (mask->f.dst_port != 0) {
+        printf(" dst-port %d", key->f.dst_port);
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * Public Functions Definitions
+ *----------------------------------------------------------------------------*/
+acl_table_t *acl_table_create(void) {
+    return calloc(1, sizeof(acl_table_t));
+}
+
+void acl_table_destroy(acl_table_t *table) {
+    free(table);
+}
+
+int acl_table_add(acl_table_t *table, const acl_rule_t *rule) {
+    if (table->count == ACL_MAX_RULES) {
+        return -1;
+    }
+
+    int id = table->next_id;
+    while (table->used[id]) {
+        id = (id + 1) % ACL_MAX_RULES;
+    }
+    table->next_id = (id + 1) % ACL_MAX_RULES;
+
+    table->rules[id] = *rule;
+    mask_key(&rule->key, &rule->mask, &table->rules[id].key); // Bits outside the mask never matter
+    memset(&table->counters[id], 0, sizeof(table->counters[id]));
+    table->used[id] = true;
+    table->count++;
+
+    return id;
+}
+
+int acl_table_remove(acl_table_t *table, int id) {
+    if (id < 0 || id >= ACL_MAX_RULES || !table->used[id]) {
+        return -1;
+    }
+
+    table->used[id] = false;
+    table->count--;
+    return 0;
+}
+
+void acl_table_print(const acl_table_t *table) {
+    static const char *action_names[] = {"permit", "deny", "mirror", "rate-limit"};
+
+    printf("%-5s %-6s %-11s %12s %14s  %s\n", "ID", "PRIO", "ACTION", "PACKETS", "BYTES", "MATCH");
+    for (int id = 0; id < ACL_MAX_RULES; id++) {
+        if (!table->used[id]) {
+            continue;
+        }
+        const acl_rule_t *rule = &table->rules[id];
+        const acl_counter_t *counter = &table->counters[id];
+
+        printf("%-5d %-6d %-11s %12llu %14llu ", id, rule->priority, action_names[rule->action],
+               (unsigned long long)__atomic_load_n(&counter->packets, __ATOMIC_RELAXED),
+               (unsigned long long)__atomic_load_n(&counter->bytes, __ATOMIC_RELAXED));
+        print_match(rule);
+        if (rule->action == ACL_MIRROR) {
+            printf(" -> port %d", rule->mirror_port + 1);
+        } else if (rule->action == ACL_RATE_LIMIT) {
+            printf(" -> %u pps burst %u (%llu limited)", rule->rate_pps, rule->burst,
+                   (unsigned long long)__atomic_load_n(&counter->limited, __ATOMIC_RELAXED));
+        }
+        printf("\n");
+    }
+    printf("%d rules\n", table->count);
+}
+
+acl_classifier_t *acl_compile(acl_table_t *table) {
+    acl_classifier_t *classifier = calloc(1, sizeof(*classifier));
+    if (classifier == NULL) {
+        return NULL;
+    }
+
+    int count = table->count;
+    classifier->entries = calloc(count > 0 ? count : 1, sizeof(acl_entry_t));
+    classifier->groups = calloc(count > 0 ? count : 1, sizeof(acl_group_t));
+    int *group_of = calloc(count > 0 ? count : 1, sizeof(int));
+    if (classifier->entries == NULL || classifier->groups == NULL || group_of == NULL) {
+        free(group_of);
+        acl_classifier_free(classifier);
+        return NULL;
+    }
+
+    for (int id = 0; id < ACL_MAX_RULES; id++) {
+        if (!table->used[id]) {
+            continue;
+        }
+        const acl_rule_t *rule = &table->rules[id];
+        acl_entry_t *entry = &classifier->entries[classifier->num_entries++];
+
+        entry->key = rule->key; // Masked by acl_table_add()
+        entry->priority = rule->priority;
+        entry->id = id;
+        entry->action = rule->action;
+        entry->mirror_port = rule->mirror_port;
+        entry->counter = &table->counters[id];
+        if (rule->action == ACL_RATE_LIMIT) {
+            entry->interval_ns = 1000000000ULL / (rule->rate_pps > 0 ? rule->rate_pps : 1);
+            entry->tolerance_ns = entry->interval_ns * (rule->burst > 1 ? rule->burst - 1 : 0);
+        }
+    }
+
+    // Highest priority first: groups are then created in max_priority order too
+    qsort(classifier->entries, classifier->num_entries, sizeof(acl_entry_t), compare_entries);
+
+    for (int i = 0; i < classifier->num_entries; i++) {
+        const acl_key_t *mask = &table->rules[classifier->entries[i].id].mask;
+        int g = 0;
+        while (g < classifier->num_groups && !keys_equal(&classifier->groups[g].mask, mask)) {
+            g++;
+        }
+        if (g == classifier->num_groups) {
+            classifier->groups[g].mask = *mask;
+            classifier->groups[g].max_priority = classifier->entries[i].priority;
+            classifier->num_groups++;
+        }
+        classifier->groups[g].count++;
+        group_of[i] = g;
+    }
+
+    for (int g = 0; g < classifier->num_groups; g++) {
+        acl_group_t *group = &classifier->groups[g];
+        uint32_t size = 2;
+        while (size < (uint32_t)group->count * 2) { // Keep the load factor under 1/2
+            size <<= 1;
+        }
+        group->hash_mask = size - 1;
+        group->buckets = calloc(size, sizeof(uint32_t));
+        if (group->buckets == NULL) {
+            free(group_of);
+            acl_classifier_free(classifier);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < classifier->num_entries; i++) {
+        acl_group_t *group = &classifier->groups[group_of[i]];
+        const acl_entry_t *entry = &classifier->entries[i];
+        uint32_t slot = hash_key(&entry->key) & group->hash_mask;
+
+        while (group->buckets[slot] != 0) {
+            // Same mask and same key as a rule already placed: it can never win, leave it out
+            if (keys_equal(&classifier->entries[group->buckets[slot] - 1].key, &entry->key)) {
+                break;
+            }
+            slot = (slot + 1) & group->hash_mask;
+        }
+        if (group->buckets[slot] == 0) {
+            group->buckets[slot] = (uint32_t)i + 1;
+        }
+    }
+
+    free(group_of);
+    return classifier;
+}
+
+void acl_classifier_free(acl_classifier_t *classifier) {
+    if (classifier == NULL) {
+        return;
+    }
+    for (int g = 0; g < classifier->num_groups; g++) {
+        free(classifier->groups[g].buckets);
+    }
+    free(classifier->groups);
+    free(classifier->entries);
+    free(classifier);
+}
+
+acl_verdict_t acl_classify(const acl_classifier_t *classifier, const uint8_t *frame, size_t len, int32_t vlan_tci) {
+    acl_verdict_t verdict = {.drop = false, .mirror_port = -1};
+    const acl_entry_t *best = NULL;
+    acl_key_t key;
+
+    if (classifier->num_groups == 0) {
+        return verdict;
+    }
+    extract_key(frame, len, vlan_tci, &key);
+
+    for (int g = 0; g < classifier->num_groups; g++) {
+        const acl_group_t *group = &classifier->groups[g];
+        acl_key_t masked;
+
+        // Groups are sorted, nothing further down can beat what we have
+        if (best != NULL && group->max_priority <= best->priority) {
+            break;
+        }
+
+        mask_key(&key, &group->mask, &masked);
+        for (uint32_t slot = hash_key(&masked) & group->hash_mask; group->buckets[slot] != 0;
+             slot = (slot + 1) & group->hash_mask) {
+            const acl_entry_t *entry = &classifier->entries[group->buckets[slot] - 1];
+            if (keys_equal(&entry->key, &masked)) {
+                if (best == NULL || entry->priority > best->priority) {
+                    best = entry;
+                }
+                break;
+            }
+        }
+    }
+
+    if (best == NULL) {
+        return verdict;
+    }
+
+    __atomic_fetch_add(&best->counter->packets, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&best->counter->bytes, len, __ATOMIC_RELAXED);
+
+    switch (best->action) {
+    case ACL_DENY:
+        verdict.drop = true;
+        break;
+    case ACL_MIRROR:
+        verdict.mirror_port = best->mirror_port;
+        break;
+    case ACL_RATE_LIMIT:
+        verdict.drop = !rate_limit_allows(best);
+        break;
+    case ACL_PERMIT:
+        break;
+    }
+
+    return verdict;
+}
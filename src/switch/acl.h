@@ -0,0 +1,161 @@
+#ifndef ACL_H
+#define ACL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*------------------------------------------------------------------------------
+ * Definitions
+ *----------------------------------------------------------------------------*/
+#define ACL_MAX_RULES 4096 // Rules per port
+#define ACL_KEY_WORDS 7
+
+#define ACL_VLAN_TAGGED 0x1000 // Set in the key's vlan field for 802.1Q frames, next to the VID
+
+/*------------------------------------------------------------------------------
+ * Types
+ *----------------------------------------------------------------------------*/
+typedef enum acl_action_en {
+    ACL_PERMIT = 0,  // Forward as usual
+    ACL_DENY,        // Drop before MAC learning
+    ACL_MIRROR,      // Forward as usual and send a copy to the mirror port
+    ACL_RATE_LIMIT,  // Forward up to rate_pps frames per second (burst frames at once), drop the rest
+} acl_action_t;
+
+/* The header fields a rule can match on. IPv4 addresses are stored
+ * IPv4-mapped (::ffff:a.b.c.d) so one field covers both families.
+ * Multi-byte integers are in host byte order.
+ */
+typedef union acl_key_un {
+    struct {
+        uint8_t dst_mac[6];
+        uint8_t src_mac[6];
+        uint16_t ethertype; // Inner ethertype for VLAN-tagged frames
+        uint16_t vlan;      // ACL_VLAN_TAGGED | VID of the outer tag, 0 if untagged
+        uint8_t src_ip[16];
+        uint8_t dst_ip[16];
+        uint16_t src_port;  // TCP/UDP/SCTP only, first fragment only
+        uint16_t dst_port;
+        uint8_t ip_proto;   // IPv4 protocol or IPv6 upper-layer next header
+        uint8_t pad[3];     // Always zero
+    } f;
+    uint64_t words[ACL_KEY_WORDS]; // Masking and hashing work on whole words
+} acl_key_t;
+
+_Static_assert(sizeof(acl_key_t) == ACL_KEY_WORDS * sizeof(uint64_t), "acl_key_t fields must fill the words");
+
+/* A rule as configured. Only the key bits set in mask are compared. */
+typedef struct acl_rule_st {
+    acl_key_t key;
+    acl_key_t mask;
+    int priority;        // The matching rule with the highest priority wins
+    acl_action_t action;
+    int mirror_port;     // ACL_MIRROR: port index (0-based) receiving the copies
+    uint32_t rate_pps;   // ACL_RATE_LIMIT: sustained rate
+    uint32_t burst;      // ACL_RATE_LIMIT: frames allowed back to back
+} acl_rule_t;
+
+/* Per-rule counters. Written by the Switch Engine with relaxed atomics,
+ * read by the CLI.
+ */
+typedef struct acl_counter_st {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t limited; // ACL_RATE_LIMIT: frames dropped over the rate
+    uint64_t tat_ns;  // ACL_RATE_LIMIT: theoretical arrival time of the next frame (GCRA)
+} acl_counter_t;
+
+/* The rules of one port, as edited by the CLI. The counters live here rather
+ * than in the compiled classifier so they survive recompilation.
+ */
+typedef struct acl_table_st {
+    acl_rule_t rules[ACL_MAX_RULES];
+    bool used[ACL_MAX_RULES];
+    int count;
+    int next_id; // Ids are handed out round-robin, so a removed rule's id is not reused right away
+    acl_counter_t counters[ACL_MAX_RULES];
+} acl_table_t;
+
+/* Read-only lookup structure compiled from an acl_table_t. */
+typedef struct acl_classifier_st acl_classifier_t;
+
+/* Outcome of classifying one frame. */
+typedef struct acl_verdict_st {
+    bool drop;
+    int mirror_port; // Port index to copy the frame to, or -1
+} acl_verdict_t;
+
+/*------------------------------------------------------------------------------
+ * Function Declarations
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief Allocate an empty rule table.
+ *
+ * @return The table, or NULL on allocation failure
+ */
+acl_table_t *acl_table_create(void);
+
+/**
+ * @brief Free a rule table.
+ *
+ * @param table The rule table (may be NULL)
+ */
+void acl_table_destroy(acl_table_t *table);
+
+/**
+ * @brief Add a rule. Its counters start at zero.
+ *
+ * @param table The rule table
+ * @param rule The rule
+ * @return The rule id, or -1 if the table is full
+ */
+int acl_table_add(acl_table_t *table, const acl_rule_t *rule);
+
+/**
+ * @brief Remove a rule.
+ *
+ * @param table The rule table
+ * @param id The rule id
+ * @return 0 on success, -1 if there is no such rule
+ */
+int acl_table_remove(acl_table_t *table, int id);
+
+/**
+ * @brief Print the rules with their hit counters.
+ *
+ * @param table The rule table
+ */
+void acl_table_print(const acl_table_t *table);
+
+/**
+ * @brief Compile the rules into a tuple space search classifier: rules are
+ *        grouped by mask, and each group is a hash table of masked keys, so a
+ *        lookup costs one hash probe per distinct mask, whatever the rule count.
+ *
+ * @param table The rule table. Must outlive the classifier (its counters are shared)
+ * @return The classifier, or NULL on allocation failure
+ */
+acl_classifier_t *acl_compile(acl_table_t *table);
+
+/**
+ * @brief Free a classifier.
+ *
+ * @param classifier The classifier (may be NULL)
+ */
+void acl_classifier_free(acl_classifier_t *classifier);
+
+/**
+ * @brief Classify a frame, count the hit and apply the rate limit.
+ *        Frames that match no rule are permitted.
+ *
+ * @param classifier The classifier
+ * @param frame The Ethernet frame
+ * @param len Length of the frame
+ * @param vlan_tci TCI of the VLAN tag the kernel stripped from the frame
+ *        (PACKET_AUXDATA), -1 if untagged
+ * @return The verdict
+ */
+acl_verdict_t acl_classify(const acl_classifier_t *classifier, const uint8_t *frame, size_t len, int32_t vlan_tci);
+
+#endif // ACL_H
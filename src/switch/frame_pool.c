@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+
+#include "frame_pool.h"
+
+/*------------------------------------------------------------------------------
+ * Definitions
+ *----------------------------------------------------------------------------*/
+#define FREELIST_END UINT32_MAX
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*------------------------------------------------------------------------------
+ * Types
+ *----------------------------------------------------------------------------*/
+typedef struct frame_pool_st {
+    frame_t *frames;
+    size_t mem_size;
+    uint32_t num_frames;
+    bool huge_pages;
+
+    /* Head of the free list: the low 32 bits are the index of the first free
+     * frame, the high 32 bits a tag bumped on every pop. The tag prevents the
+     * ABA problem when a frame is popped and pushed back between our read of
+     * the head and our compare-and-swap.
+     */
+    uint64_t free_head __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint32_t free_count;
+} frame_pool_t;
+
+/*------------------------------------------------------------------------------
+ * Static Variables
+ *----------------------------------------------------------------------------*/
+static frame_pool_t frame_pool;
+
+/*------------------------------------------------------------------------------
+ * Static Function Declarations
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief Push a frame onto the free list.
+ *
+ * @param frame The frame to push
+ */
+static void freelist_push(frame_t *frame);
+
+/*------------------------------------------------------------------------------
+ * Static Functions Definitions
+ *----------------------------------------------------------------------------*/
+static void freelist_push(frame_t *frame) {
+    uint32_t index = (uint32_t)(frame - frame_pool.frames);
+    uint64_t head = __atomic_load_n(&frame_pool.free_head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+
+    do {
+        frame->meta.next_free = (uint32_t)head;
+        new_head = (head & 0xffffffff00000000ULL) | index;
+    } while (!__atomic_compare_exchange_n(&frame_pool.free_head, &head, new_head, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+
+    __atomic_fetch_add(&frame_pool.free_count, 1, __ATOMIC_RELAXED);
+}
+
+/*------------------------------------------------------------------------------
+ * Public Functions Definitions
+ *----------------------------------------------------------------------------*/
+int frame_pool_init(uint32_t num_frames) {
+    size_t size = (size_t)num_frames * sizeof(frame_t);
+
+    // Huge pages cut TLB misses when the data path touches many frames
+    size_t huge_size = (size + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1);
+    void *mem = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    frame_pool.huge_pages = (mem != MAP_FAILED);
+
+    if (!frame_pool.huge_pages) {
+        huge_size = size;
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (mem == MAP_FAILED) {
+            perror("Frame pool allocation failed");
+            return -1;
+        }
+    }
+
+    frame_pool.frames = mem;
+    frame_pool.mem_size = huge_size;
+    frame_pool.num_frames = num_frames;
+    frame_pool.free_head = FREELIST_END;
+    frame_pool.free_count = 0;
+
+    for (uint32_t i = num_frames; i > 0; i--) {
+        freelist_push(&frame_pool.frames[i - 1]);
+    }
+
+    return 0;
+}
+
+void frame_pool_destroy(void) {
+    if (frame_pool.frames != NULL) {
+        munmap(frame_pool.frames, frame_pool.mem_size);
+        frame_pool.frames = NULL;
+    }
+}
+
+frame_t *frame_alloc(void) {
+    uint64_t head = __atomic_load_n(&frame_pool.free_head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    frame_t *frame;
+
+    do {
+        uint32_t index = (uint32_t)head;
+        if (index == FREELIST_END) {
+            return NULL; // Pool exhausted
+        }
+        frame = &frame_pool.frames[index];
+        uint64_t tag = (head >> 32) + 1;
+        new_head = (tag << 32) | __atomic_load_n(&frame->meta.next_free, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&frame_pool.free_head, &head, new_head, true,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    __atomic_fetch_sub(&frame_pool.free_count, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&frame->meta.refcnt, 1, __ATOMIC_RELAXED);
+    return frame;
+}
+
+void frame_get(frame_t *frame) {
+    __atomic_fetch_add(&frame->meta.refcnt, 1, __ATOMIC_RELAXED);
+}
+
+void frame_put(frame_t *frame) {
+    if (__atomic_sub_fetch(&frame->meta.refcnt, 1, __ATOMIC_ACQ_REL) == 0) {
+        freelist_push(frame);
+    }
+}
+
+unsigned char *frame_data(frame_t *frame) {
+    return frame->buf + FRAME_HEADROOM;
+}
+
+uint32_t frame_pool_available(void) {
+    return __atomic_load_n(&frame_pool.free_count, __ATOMIC_RELAXED);
+}
+
+uint32_t frame_pool_size(void) {
+    return frame_pool.num_frames;
+}
+
+bool frame_pool_on_huge_pages(void) {
+    return frame_pool.huge_pages;
+}
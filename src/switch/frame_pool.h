@@ -0,0 +1,108 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*------------------------------------------------------------------------------
+ * Definitions
+ *----------------------------------------------------------------------------*/
+#define CACHE_LINE_SIZE 64
+#define FRAME_SIZE 2048     // Total size of one pool slot (metadata + buffer)
+#define FRAME_HEADROOM 128  // Free space in front of the frame (io_uring recvmsg header, or to push a VLAN tag)
+#define FRAME_TAILROOM 64   // Free space behind the frame (e.g. to append an FCS)
+#define FRAME_DATA_MAX (FRAME_SIZE - sizeof(frame_meta_t) - FRAME_HEADROOM - FRAME_TAILROOM)
+
+/*------------------------------------------------------------------------------
+ * Types
+ *----------------------------------------------------------------------------*/
+typedef struct frame_meta_st {
+    uint32_t refcnt;        // Number of owners (RX path + every egress queue holding it)
+    uint32_t next_free;     // Freelist link (pool index), only valid while free
+    uint16_t len;           // Length of the frame data
+    int8_t ingress_port;    // Port the frame was received on (0-based)
+    uint8_t path;           // Forwarding path taken by the switch
+    int32_t vlan_tci;       // TCI of the 802.1Q tag the kernel stripped on RX, -1 if untagged
+    struct timespec rx_ts;  // Kernel RX timestamp (zero if unavailable)
+} __attribute__((aligned(CACHE_LINE_SIZE))) frame_meta_t;
+
+/* One pool slot. The metadata sits in its own cache line, followed by the
+ * headroom and the frame data, so data always starts cache-aligned + headroom.
+ */
+typedef struct frame_st {
+    frame_meta_t meta;
+    unsigned char buf[FRAME_SIZE - sizeof(frame_meta_t)];
+} __attribute__((aligned(CACHE_LINE_SIZE))) frame_t;
+
+/*------------------------------------------------------------------------------
+ * Function Declarations
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief Allocate the frame pool.
+ *        All memory is allocated here, once. Huge pages are tried first
+ *        and regular pages are used if none are available.
+ *
+ * @param num_frames Number of frames in the pool
+ * @return 0 on success, -1 on failure
+ */
+int frame_pool_init(uint32_t num_frames);
+
+/**
+ * @brief Release the frame pool memory.
+ */
+void frame_pool_destroy(void);
+
+/**
+ * @brief Take a frame from the pool. The caller owns the only reference.
+ *        Lock-free, safe to call from any thread.
+ *
+ * @return The frame, or NULL if the pool is empty
+ */
+frame_t *frame_alloc(void);
+
+/**
+ * @brief Take an additional reference on a frame (e.g. to queue it on one more port).
+ *
+ * @param frame The frame
+ */
+void frame_get(frame_t *frame);
+
+/**
+ * @brief Drop a reference on a frame. The frame returns to the pool
+ *        when the last reference is dropped.
+ *
+ * @param frame The frame
+ */
+void frame_put(frame_t *frame);
+
+/**
+ * @brief Get a pointer to the frame data (after the headroom).
+ *
+ * @param frame The frame
+ * @return The frame data
+ */
+unsigned char *frame_data(frame_t *frame);
+
+/**
+ * @brief Get the number of free frames in the pool.
+ *
+ * @return The number of free frames
+ */
+uint32_t frame_pool_available(void);
+
+/**
+ * @brief Get the total number of frames in the pool.
+ *
+ * @return The number of frames
+ */
+uint32_t frame_pool_size(void);
+
+/**
+ * @brief Check whether the pool is backed by huge pages.
+ *
+ * @return true if huge pages are used
+ */
+bool frame_pool_on_huge_pages(void);
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,113 @@
+#include <stdint.h>
+
+#include "latency_hist.h"
+
+/*------------------------------------------------------------------------------
+ * Static Function Declarations
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief Map a value to its bucket index.
+ *
+ * @param value_ns The value in nanoseconds
+ * @return The bucket index
+ */
+static int bucket_index(uint64_t value_ns);
+
+/**
+ * @brief Map a bucket index back to a representative value (bucket midpoint).
+ *
+ * @param index The bucket index
+ * @return The value in nanoseconds
+ */
+static uint64_t bucket_value(int index);
+
+/*------------------------------------------------------------------------------
+ * Static Functions Definitions
+ *----------------------------------------------------------------------------*/
+static int bucket_index(uint64_t value_ns) {
+    // Small values get one bucket each
+    if (value_ns < LATENCY_HIST_SUB_BUCKETS) {
+        return (int)value_ns;
+    }
+
+    int exp = 63 - __builtin_clzll(value_ns);
+    if (exp > LATENCY_HIST_MAX_EXP) {
+        return LATENCY_HIST_BUCKETS - 1; // Saturate, max_ns still has the real value
+    }
+
+    // The top LATENCY_HIST_SUB_BITS bits below the leading one select the sub-bucket
+    int shift = exp - LATENCY_HIST_SUB_BITS;
+    int sub = (int)((value_ns >> shift) & (LATENCY_HIST_SUB_BUCKETS - 1));
+    return (exp - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS + sub;
+}
+
+static uint64_t bucket_value(int index) {
+    if (index < LATENCY_HIST_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+
+    int exp = index / LATENCY_HIST_SUB_BUCKETS + LATENCY_HIST_SUB_BITS - 1;
+    int sub = index % LATENCY_HIST_SUB_BUCKETS;
+    int shift = exp - LATENCY_HIST_SUB_BITS;
+    uint64_t low = ((uint64_t)(LATENCY_HIST_SUB_BUCKETS + sub)) << shift;
+    return low + ((1ULL << shift) >> 1);
+}
+
+/*------------------------------------------------------------------------------
+ * Public Functions Definitions
+ *----------------------------------------------------------------------------*/
+void latency_hist_record(latency_hist_t *hist, uint64_t value_ns) {
+    __atomic_fetch_add(&hist->buckets[bucket_index(value_ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELEASE);
+
+    // Only the engine writes, so a plain compare-then-store is enough
+    if (value_ns > __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&hist->max_ns, value_ns, __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t latency_hist_percentile(latency_hist_t *hist, double percentile) {
+    /* Sum the buckets instead of trusting count: the engine may record
+     * while we read, so this keeps the rank consistent with what we see.
+     */
+    uint64_t total = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        total += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        if (seen >= rank) {
+            uint64_t value = bucket_value(i);
+            uint64_t max = latency_hist_max(hist);
+            return value < max ? value : max;
+        }
+    }
+
+    return latency_hist_max(hist);
+}
+
+uint64_t latency_hist_count(latency_hist_t *hist) {
+    return __atomic_load_n(&hist->count, __ATOMIC_ACQUIRE);
+}
+
+uint64_t latency_hist_max(latency_hist_t *hist) {
+    return __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+}
+
+void latency_hist_reset(latency_hist_t *hist) {
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        __atomic_store_n(&hist->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&hist->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->max_ns, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,73 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ * Definitions
+ *----------------------------------------------------------------------------*/
+/* HDR-style log-linear buckets: every power of two is split into
+ * 2^LATENCY_HIST_SUB_BITS linear sub-buckets, which keeps the relative
+ * error of a recorded value below ~6% over the whole range.
+ */
+#define LATENCY_HIST_SUB_BITS 4
+#define LATENCY_HIST_SUB_BUCKETS (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_EXP 40 // Values up to 2^40 ns (~18 minutes)
+#define LATENCY_HIST_BUCKETS ((LATENCY_HIST_MAX_EXP - LATENCY_HIST_SUB_BITS + 2) * LATENCY_HIST_SUB_BUCKETS)
+
+/*------------------------------------------------------------------------------
+ * Types
+ *----------------------------------------------------------------------------*/
+/* Single writer (the Switch Engine), any number of readers (the CLI).
+ * All fields are accessed with atomic builtins, no lock is needed.
+ */
+typedef struct latency_hist_st {
+    uint64_t buckets[LATENCY_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t max_ns;
+} latency_hist_t;
+
+/*------------------------------------------------------------------------------
+ * Function Declarations
+ *----------------------------------------------------------------------------*/
+/**
+ * @brief Record a latency sample.
+ *
+ * @param hist The histogram
+ * @param value_ns The latency in nanoseconds
+ */
+void latency_hist_record(latency_hist_t *hist, uint64_t value_ns);
+
+/**
+ * @brief Get the value at a given percentile.
+ *
+ * @param hist The histogram
+ * @param percentile The percentile (0.0 to 100.0)
+ * @return The latency in nanoseconds, or 0 if the histogram is empty
+ */
+uint64_t latency_hist_percentile(latency_hist_t *hist, double percentile);
+
+/**
+ * @brief Get the number of recorded samples.
+ *
+ * @param hist The histogram
+ * @return The number of samples
+ */
+uint64_t latency_hist_count(latency_hist_t *hist);
+
+/**
+ * @brief Get the largest recorded sample.
+ *
+ * @param hist The histogram
+ * @return The maximum latency in nanoseconds
+ */
+uint64_t latency_hist_max(latency_hist_t *hist);
+
+/**
+ * @brief Clear all samples.
+ *
+ * @param hist The histogram
+ */
+void latency_hist_reset(latency_hist_t *hist);
+
+#endif // LATENCY_HIST_H
@@ -1,31 +1,31 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "mac_table.h"
+
 /*------------------------------------------------------------------------------
  * Definitions
  *----------------------------------------------------------------------------*/
-#define TABLE_SIZE 1024
+#define MAC_SNAPSHOT_MAGIC 0x544d5753 // "SWMT"
+#define MAC_SNAPSHOT_VERSION 1
 
 /*------------------------------------------------------------------------------
  * Types
  *----------------------------------------------------------------------------*/
-typedef struct mac_entry_st {
-    unsigned char mac[MAC_ADDR_LEN];
-    uint8_t port_index;
-} mac_entry_t;
-
-typedef struct mac_table_st {
-    mac_entry_t entries[TABLE_SIZE];
+/* Snapshot file layout: this header followed by count mac_entry_t records,
+ * exactly as they sit in the table, so loading is a single memcpy.
+ */
+typedef struct mac_snapshot_header_st {
+    uint32_t magic;
+    uint16_t version;
     uint16_t count;
-} mac_table_t;
-
-/*------------------------------------------------------------------------------
- * Static Variables
- *----------------------------------------------------------------------------*/
-static mac_table_t mac_table;
-
+} mac_snapshot_header_t;
 /*------------------------------------------------------------------------------
  * Static Function Declarations
  *----------------------------------------------------------------------------*/
@@ -35,40 +35,84 @@ static mac_table_t mac_table;
  *
  * @param mac The MAC address to print
  */
-static void print_mac(unsigned char *mac);
+static void print_mac(const unsigned char *mac);
+
+/**
+ * @brief Find the entry for a MAC address.
+ *
+ * @param table The MAC table
+ * @param mac The MAC address
+ * @return The entry index, or -1 if not found
+ */
+static int find_entry(const mac_table_t *table, const unsigned char *mac);
+
+/**
+ * @brief Remove an entry by swapping the last entry into its place.
+ *
+ * @param table The MAC table
+ * @param index The entry index
+ */
+static void remove_entry(mac_table_t *table, int index);
 
 /*------------------------------------------------------------------------------
  * Static Functions Definitions
  *----------------------------------------------------------------------------*/
-static void print_mac(unsigned char *mac) {
+static void print_mac(const unsigned char *mac) {
     printf("%02x:%02x:%02x:%02x:%02x:%02x",
            mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
+static int find_entry(const mac_table_t *table, const unsigned char *mac) {
+    for (int i = 0; i < table->count; i++) {
+        if (memcmp(table->entries[i].mac, mac, MAC_ADDR_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void remove_entry(mac_table_t *table, int index) {
+    table->entries[index] = table->entries[table->count - 1];
+    table->count--;
+}
+
 /*------------------------------------------------------------------------------
  * Public Functions Definitions
  *----------------------------------------------------------------------------*/
-void mac_table_update(unsigned char *src_mac, uint8_t port) {
+void mac_table_init(mac_table_t *table) {
+    memset(table, 0, sizeof(*table));
+}
+
+void mac_table_update(mac_table_t *table, unsigned char *src_mac, uint8_t port) {
 
     // Check if we already know this MAC
-    for (int i = 0; i < mac_table.count; i++) {
-        if (memcmp(mac_table.entries[i].mac, src_mac, MAC_ADDR_LEN) == 0) {
+    for (int i = 0; i < table->count; i++) {
+        if (memcmp(table->entries[i].mac, src_mac, MAC_ADDR_LEN) == 0) {
+            // Static entries are pinned to their port, whatever the traffic says
+            if (table->entries[i].flags & MAC_ENTRY_STATIC) {
+                return;
+            }
+
+            // Traffic confirms a snapshot entry, it is now a regular learned one
+            table->entries[i].flags &= ~MAC_ENTRY_PROVISIONAL;
+
             // Found it! Update timestamp and port (in case it moved)
-            if (mac_table.entries[i].port_index != port) {
+            if (table->entries[i].port_index != port) {
                 printf("MAC moved! ");
                 print_mac(src_mac);
-                printf(" moved from Port %d to Port %d\n", mac_table.entries[i].port_index, port + 1);
-                mac_table.entries[i].port_index = port;
+                printf(" moved from Port %d to Port %d\n", table->entries[i].port_index, port + 1);
+                table->entries[i].port_index = port;
             }
             return; // Done
         }
     }
 
     // If not found, add new entry
-    if (mac_table.count < TABLE_SIZE) {
-        memcpy(mac_table.entries[mac_table.count].mac, src_mac, MAC_ADDR_LEN);
-        mac_table.entries[mac_table.count].port_index = port;
-        mac_table.count++;
+    if (table->count < MAC_TABLE_SIZE) {
+        memcpy(table->entries[table->count].mac, src_mac, MAC_ADDR_LEN);
+        table->entries[table->count].port_index = port;
+        table->entries[table->count].flags = 0;
+        table->count++;
 
         printf("LEARNED: ");
         print_mac(src_mac);
@@ -78,7 +122,7 @@ void mac_table_update(unsigned char *src_mac, uint8_t port) {
     }
 }
 
-int mac_table_lookup_port(unsigned char *dst_mac) {
+int mac_table_lookup_port(mac_table_t *table, unsigned char *dst_mac) {
     // Broadcast address (FF:FF:FF:FF:FF:FF) must ALWAYS be flooded
     unsigned char broadcast[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
     if (memcmp(dst_mac, broadcast, MAC_ADDR_LEN) == 0) {
@@ -86,22 +130,165 @@ int mac_table_lookup_port(unsigned char *dst_mac) {
     }
 
     // Search the table
-    for (int i = 0; i < mac_table.count; i++) {
-        if (memcmp(mac_table.entries[i].mac, dst_mac, MAC_ADDR_LEN) == 0) {
-            return mac_table.entries[i].port_index; // Found the specific port!
+    for (int i = 0; i < table->count; i++) {
+        if (memcmp(table->entries[i].mac, dst_mac, MAC_ADDR_LEN) == 0) {
+            return table->entries[i].port_index; // Found the specific port!
         }
     }
 
     return -1; // Not found -> Flood
 }
 
-void mac_table_flush_port(uint8_t port) {
-    for (int i = 0; i < mac_table.count; i++) {
-        if (mac_table.entries[i].port_index == port) {
+void mac_table_flush_port(mac_table_t *table, uint8_t port) {
+    for (int i = 0; i < table->count; i++) {
+        if (table->entries[i].port_index == port && !(table->entries[i].flags & MAC_ENTRY_STATIC)) {
             // Swap with last entry and shrink table
-            mac_table.entries[i] = mac_table.entries[mac_table.count - 1];
-            mac_table.count--;
+            remove_entry(table, i);
+            i--; // Re-check this index since we swapped in a new entry
+        }
+    }
+}
+
+int mac_table_add_static(mac_table_t *table, const unsigned char *mac, uint8_t port) {
+    int i = find_entry(table, mac);
+
+    if (i == -1) {
+        if (table->count == MAC_TABLE_SIZE) {
+            return -1;
+        }
+        i = table->count++;
+        memcpy(table->entries[i].mac, mac, MAC_ADDR_LEN);
+    }
+
+    table->entries[i].port_index = port;
+    table->entries[i].flags = MAC_ENTRY_STATIC;
+    return 0;
+}
+
+int mac_table_remove_static(mac_table_t *table, const unsigned char *mac) {
+    int i = find_entry(table, mac);
+
+    if (i == -1 || !(table->entries[i].flags & MAC_ENTRY_STATIC)) {
+        return -1;
+    }
+
+    remove_entry(table, i);
+    return 0;
+}
+
+void mac_table_expire_provisional(mac_table_t *table, time_t now) {
+    if (table->provisional_deadline == 0 || now < table->provisional_deadline) {
+        return;
+    }
+
+    for (int i = 0; i < table->count; i++) {
+        if (table->entries[i].flags & MAC_ENTRY_PROVISIONAL) {
+            remove_entry(table, i);
             i--; // Re-check this index since we swapped in a new entry
         }
     }
+    table->provisional_deadline = 0; // Nothing provisional left
+}
+
+void mac_table_print(const mac_table_t *table) {
+    printf("%-17s  %-4s  %s\n", "MAC", "PORT", "TYPE");
+    for (int i = 0; i < table->count; i++) {
+        const mac_entry_t *entry = &table->entries[i];
+        const char *type = "learned";
+        if (entry->flags & MAC_ENTRY_STATIC) {
+            type = "static";
+        } else if (entry->flags & MAC_ENTRY_PROVISIONAL) {
+            type = "provisional";
+        }
+
+        print_mac(entry->mac);
+        printf("  %-4d  %s\n", entry->port_index + 1, type);
+    }
+    printf("%d entries\n", table->count);
+}
+
+int mac_table_save(const mac_table_t *table, const char *path) {
+    mac_snapshot_header_t header = {
+        .magic = MAC_SNAPSHOT_MAGIC,
+        .version = MAC_SNAPSHOT_VERSION,
+        .count = 0,
+    };
+    mac_entry_t entries[MAC_TABLE_SIZE];
+
+    /* Static entries come from the configuration, only learned ones are persisted.
+     * Provisional entries are left out too: rewriting them would give a host that
+     * has left a fresh deadline on every restart.
+     */
+    for (int i = 0; i < table->count; i++) {
+        if (!(table->entries[i].flags & (MAC_ENTRY_STATIC | MAC_ENTRY_PROVISIONAL))) {
+            entries[header.count++] = table->entries[i];
+        }
+    }
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (file == NULL) {
+        perror("Opening MAC snapshot failed");
+        return -1;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(entries, sizeof(mac_entry_t), header.count, file) == header.count;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) < 0) {
+        perror("Writing MAC snapshot failed");
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int mac_table_load(mac_table_t *table, const char *path, int num_ports, time_t provisional_deadline) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1; // No snapshot yet, cold start
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(mac_snapshot_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return -1;
+    }
+
+    const mac_snapshot_header_t *header = mem;
+    const mac_entry_t *entries = (const mac_entry_t *)(header + 1);
+    int loaded = -1;
+
+    if (header->magic == MAC_SNAPSHOT_MAGIC && header->version == MAC_SNAPSHOT_VERSION &&
+        header->count <= MAC_TABLE_SIZE &&
+        (size_t)st.st_size == sizeof(*header) + header->count * sizeof(mac_entry_t)) {
+
+        // The table is empty at startup, so the whole file goes in with one copy
+        memcpy(table->entries, entries, header->count * sizeof(mac_entry_t));
+        table->count = header->count;
+
+        for (int i = 0; i < table->count; i++) {
+            if (table->entries[i].port_index >= num_ports) {
+                remove_entry(table, i);
+                i--; // Re-check this index since we swapped in a new entry
+                continue;
+            }
+            table->entries[i].flags = MAC_ENTRY_PROVISIONAL;
+        }
+        table->provisional_deadline = provisional_deadline;
+        loaded = table->count;
+    }
+
+    munmap(mem, st.st_size);
+    return loaded;
 }
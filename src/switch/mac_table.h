@@ -2,37 +2,125 @@
 #define MAC_TABLE_H
 
 #include <stdint.h>
+#include <time.h>
 
 /*------------------------------------------------------------------------------
  * Definitions
  *----------------------------------------------------------------------------*/
 #define MAC_ADDR_LEN 6
+#define MAC_TABLE_SIZE 1024
 
+#define MAC_ENTRY_STATIC 0x01      // Configured by the user: never moves, never flushed
+#define MAC_ENTRY_PROVISIONAL 0x02 // Loaded from a snapshot, not yet confirmed by traffic
+
+/*------------------------------------------------------------------------------
+ * Types
+ *----------------------------------------------------------------------------*/
+typedef struct mac_entry_st {
+    unsigned char mac[MAC_ADDR_LEN];
+    uint8_t port_index;
+    uint8_t flags; // MAC_ENTRY_* flags, 0 for a learned entry
+} mac_entry_t;
+
+/* One table per switch instance. Only the Switch Engine thread serving
+ * the instance touches it, so no locking is needed.
+ */
+typedef struct mac_table_st {
+    mac_entry_t entries[MAC_TABLE_SIZE];
+    uint16_t count;
+    time_t provisional_deadline; // Monotonic second after which unconfirmed entries are dropped
+} mac_table_t;
 
 /*------------------------------------------------------------------------------
  * Function Declarations
  *----------------------------------------------------------------------------*/
+/**
+ * @brief Initialize (empty) a MAC table.
+ *
+ * @param table The MAC table
+ */
+void mac_table_init(mac_table_t *table);
+
 /**
  * @brief Update the MAC table with a new MAC address and port.
  *
+ * @param table The MAC table
  * @param src_mac The source MAC address
  * @param port The port number
  */
-void mac_table_update(unsigned char *src_mac, uint8_t port);
+void mac_table_update(mac_table_t *table, unsigned char *src_mac, uint8_t port);
 
 /**
  * @brief Lookup the port number for a given MAC address.
  *
+ * @param table The MAC table
  * @param dst_mac The destination MAC address
  * @return The port number, or -1 if not found
  */
-int mac_table_lookup_port(unsigned char *dst_mac);
+int mac_table_lookup_port(mac_table_t *table, unsigned char *dst_mac);
 
 /**
- * @brief Flush the MAC table for a given port.
+ * @brief Flush the MAC table for a given port. Static entries are kept.
  *
+ * @param table The MAC table
  * @param port The port number
  */
-void mac_table_flush_port(uint8_t port);
+void mac_table_flush_port(mac_table_t *table, uint8_t port);
+
+/**
+ * @brief Add a static entry, or turn an existing entry into a static one.
+ *
+ * @param table The MAC table
+ * @param mac The MAC address
+ * @param port The port number
+ * @return 0 on success, -1 if the table is full
+ */
+int mac_table_add_static(mac_table_t *table, const unsigned char *mac, uint8_t port);
+
+/**
+ * @brief Remove a static entry.
+ *
+ * @param table The MAC table
+ * @param mac The MAC address
+ * @return 0 on success, -1 if there is no static entry for the MAC
+ */
+int mac_table_remove_static(mac_table_t *table, const unsigned char *mac);
+
+/**
+ * @brief Drop the provisional entries that traffic has not confirmed in time.
+ *
+ * @param table The MAC table
+ * @param now Current monotonic time in seconds
+ */
+void mac_table_expire_provisional(mac_table_t *table, time_t now);
+
+/**
+ * @brief Print all entries.
+ *
+ * @param table The MAC table
+ */
+void mac_table_print(const mac_table_t *table);
+
+/**
+ * @brief Write the learned entries confirmed by traffic (not static, not provisional) to a snapshot file.
+ *        The file is written next to path and renamed, so it is never seen half written.
+ *
+ * @param table The MAC table
+ * @param path Path of the snapshot file
+ * @return 0 on success, -1 on failure
+ */
+int mac_table_save(const mac_table_t *table, const char *path);
+
+/**
+ * @brief Bulk-load a snapshot file into an empty table.
+ *        Entries are marked provisional until traffic confirms them.
+ *
+ * @param table The MAC table
+ * @param path Path of the snapshot file
+ * @param num_ports Number of ports, entries for other ports are skipped
+ * @param provisional_deadline Monotonic second after which unconfirmed entries are dropped
+ * @return The number of entries loaded, or -1 if there is no valid snapshot
+ */
+int mac_table_load(mac_table_t *table, const char *path, int num_ports, time_t provisional_deadline);
 
 #endif // MAC_TABLE_H
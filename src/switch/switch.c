@@ -1,5 +1,10 @@
+#define _GNU_SOURCE // pthread_setaffinity_np()
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <poll.h>
@@ -7,16 +12,49 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
 
 #include "switch.h"
 #include "mac_table.h"
+#include "acl.h"
+#include "latency_hist.h"
+#include "frame_pool.h"
 #include "net/socket.h"
+#include "net/uring.h"
 
 /*------------------------------------------------------------------------------
  * Definitions
  *----------------------------------------------------------------------------*/
-#define ETH_PAYLOAD_MAX 1500
-#define ETH_TYPE_IPV6 0x86dd
+#define POLL_TIMEOUT_MS 1000
+#define BUSY_POLL_SOCKET_US 50 // Per-socket kernel busy poll budget in busy-poll mode
+#define FRAME_POOL_SIZE 4096    // Frames preallocated at startup, shared by all instances
+#define RX_BATCH 32             // Max frames read from one port per poll() round
+#define TX_QUEUE_DEPTH 64       // Frames queued on one egress port before it is flushed early
+#define MAC_REQUEST_QUEUE 16    // Static MAC changes waiting for the Switch Engine, per instance
+#define MAC_PROVISIONAL_TIMEOUT_S 300 // Snapshot entries not confirmed by traffic by then are dropped
+
+#define URING_ENTRIES 256       // SQ entries per worker ring
+#define URING_BUF_ENTRIES 64    // Provided RX buffers per worker ring (power of two)
+#define URING_BUF_GROUP 0
+/* A multishot recvmsg completion buffer starts with a struct io_uring_recvmsg_out
+ * followed by the control data (we ask for no address). The buffer handed to the
+ * kernel starts this far in front of frame_data(), so that prefix lands in the
+ * frame headroom and the payload lands exactly at frame_data().
+ */
+#define URING_RECV_PREFIX (sizeof(struct io_uring_recvmsg_out) + SOCKET_RX_CONTROL_LEN)
+/* The top byte of a user_data says what completed. For RECV the rest is the
+ * slot generation (bits 32-47) and slot index (bits 0-31), for SEND it is the
+ * frame pointer (user space pointers fit in 56 bits).
+ */
+#define URING_OP_SHIFT 56
+#define URING_OP_RECV 1ULL
+#define URING_OP_SEND 2ULL
+#define URING_OP_CANCEL 3ULL
+#define URING_PTR_MASK ((1ULL << URING_OP_SHIFT) - 1)
+
+_Static_assert(URING_RECV_PREFIX <= FRAME_HEADROOM, "recvmsg header must fit in the frame headroom");
 
 /*------------------------------------------------------------------------------
  * Types
@@ -29,6 +67,15 @@ typedef struct ethernet_header_st {
     uint16_t ether_type;
 } ethernet_header_t;
 
+/* Frames waiting to be sent on a port. Filled while processing RX and
+ * flushed once per poll() round, so a burst is forwarded in one go.
+ */
+typedef struct switch_tx_queue_st {
+    frame_t *frames[TX_QUEUE_DEPTH];
+    uint16_t count;
+    uint64_t drops; // Frames dropped because no io_uring SQE was free
+} switch_tx_queue_t;
+
 typedef struct switch_port_info_st {
     int socket_fd;          // The actual file descriptor (or -1 if down)
     char if_name[IFNAMSIZ]; // Name of the interface (e.g., "veth1")
@@ -37,20 +84,126 @@ typedef struct switch_port_info_st {
     bool request_connect;         // 1 = CLI wants to connect this port
     char pending_name[IFNAMSIZ]; // The name CLI wants to connect to
     bool request_disconnect;      // 1 = CLI wants to disconnect this port
+
+    switch_tx_queue_t tx_queue;   // Owned by the Switch Engine
+    int uring_slot;               // Slot in the worker's io_uring slot table (-1 if none)
+
+    acl_table_t *acl_rules;       // Ingress rules as configured, only touched by the CLI (NULL if none yet)
+    acl_classifier_t *acl;        // Compiled ingress rules, swapped atomically by the CLI (NULL = permit all)
+    bool acl_dirty;               // Rules changed since the last commit, only touched by the CLI
 } switch_port_info_t;
 
-typedef struct switch_st {
-    unsigned char frame_buffer[ETH_PAYLOAD_MAX + sizeof(ethernet_header_t)];
+typedef enum switch_path_en {
+    PATH_UNICAST = 0, // Destination MAC was known, frame sent to one port
+    PATH_FLOOD,       // Destination unknown or broadcast, frame sent to all ports
+    PATH_COUNT
+} switch_path_t;
+
+typedef struct switch_latency_config_st {
+    bool busy_poll;      // true = spin on the port sockets instead of sleeping in poll()
+    int cpu;             // Worker N is pinned to core cpu + N while busy polling
+    int idle_us;         // Keep spinning this long after the last frame, then block again
+
+    unsigned generation; // Bumped by the CLI on every change, workers apply it when it moves
+} switch_latency_config_t;
+
+typedef struct switch_stats_st {
+    uint64_t busy_us;     // Time spent between waits: processing frames and requests
+    uint64_t spin_us;     // Time spent in waits with a zero timeout
+    uint64_t blocked_us;  // Time spent in waits that were allowed to block
+    uint64_t pool_empty;  // RX attempts skipped because no frame was free
+    bool spinning;        // true = the last wait was a spin
+    uint64_t last_wake_us; // End of the last wait
+} switch_stats_t;
+
+/* A static MAC change requested by the CLI. Like port requests, it is
+ * applied by the Switch Engine, which owns the MAC table.
+ */
+typedef struct mac_request_st {
+    unsigned char mac[MAC_ADDR_LEN];
+    int port_index; // Port of the new static entry, or -1 to remove the static entry
+} mac_request_t;
+
+/* A port with a multishot recv on a worker's ring. Completions refer to the
+ * slot, not to the instance, so a completion that arrives after the port was
+ * disconnected (or the instance freed) is recognised by its old generation.
+ */
+typedef struct uring_port_slot_st {
+    switch_t *sw;        // Instance owning the slot (NULL if free)
+    int port_index;
+    uint16_t generation; // Bumped every time the slot is released
+    bool armed;          // true = a multishot recv is outstanding
+    bool cancel_pending; // true = the recv of the previous generation still needs its cancel
+} uring_port_slot_t;
+
+typedef struct switch_worker_st switch_worker_t;
+
+/* One bridge domain: its own ports, MAC table and histograms. An instance
+ * is served by exactly one worker, so its data path is single-threaded.
+ */
+struct switch_st {
+    char name[SWITCH_NAME_LEN];
     switch_port_info_t port[MAX_PORTS]; // Shared state between CLI and Switch Engine
-    bool shutdown;
-} switch_t;
+    mac_table_t mac_table;              // Owned by the Switch Engine
+    latency_hist_t latency_hist[MAX_PORTS][PATH_COUNT]; // RX-to-TX latency per egress port and path
+
+    switch_worker_t *worker; // Worker serving this instance (NULL if not started)
+    bool request_stop;       // 1 = CLI wants the worker to drop this instance
+
+    mac_request_t mac_requests[MAC_REQUEST_QUEUE]; // Shared state between CLI and Switch Engine
+    int num_mac_requests;
+
+    mac_table_t snapshot;    // Copy of mac_table taken by the worker for the snapshot thread
+    unsigned snapshot_seq;   // Bumped by the worker on every copy
+    unsigned saved_seq;      // Last copy written to disk by the snapshot thread
+    time_t next_snapshot_s;  // Monotonic second of the next copy
+};
+
+/* A Switch Engine thread. Workers are shared: each one polls the ports
+ * of every instance assigned to it.
+ */
+struct switch_worker_st {
+    pthread_t thread_id;
+    int index;
+    switch_t *instances[MAX_SWITCHES]; // Instances served by this worker
+    int num_instances;
+    unsigned request_generation; // Bumped by the CLI after queuing work for this worker, read without the lock
+    unsigned handled_generation; // request_generation seen by the last round that took the lock
+    int num_owners;              // num_instances as of that round
+
+    time_t last_housekeeping_s;  // Monotonic second of the last MAC table housekeeping
+    unsigned latency_generation; // Last latency config generation applied
+    bool busy_poll;              // Snapshot of the latency config taken with the lock held
+    int idle_us;
+    cpu_set_t default_affinity;  // Affinity of the thread before pinning
+    switch_stats_t stats;        // Written by this worker only
+    uint64_t quiescent_epoch;    // Bumped around every wait: odd while blocked, with no ACL lookup in flight
+
+    switch_backend_t backend;                       // Backend in use (io_uring falls back to poll)
+    uring_t ring;
+    struct msghdr recv_msg;                         // Template for the multishot recvmsg
+    frame_t *buf_frames[URING_BUF_ENTRIES];         // Frame behind each provided buffer id
+    uint16_t empty_bids[URING_BUF_ENTRIES];         // Buffer ids waiting for a fresh frame
+    int num_empty_bids;
+    uring_port_slot_t slots[MAX_SWITCHES * MAX_PORTS];
+};
 
 /*------------------------------------------------------------------------------
  * Static Variables
  *----------------------------------------------------------------------------*/
-static switch_t switch_inst;
-static pthread_t switch_thread_id;
+static switch_t *instances[MAX_SWITCHES];
+static switch_worker_t workers[MAX_WORKERS];
+static int num_workers;
+static switch_latency_config_t latency_config;
+static bool shutdown_requested;
 static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t instance_stopped = PTHREAD_COND_INITIALIZER;
+static char snapshot_dir[PATH_MAX]; // Where MAC table snapshots live ("" = disabled)
+static int snapshot_interval_s;     // 0 = only snapshot on exit
+static pthread_t snapshot_thread_id;
+static bool snapshot_thread_running;
+static pthread_cond_t snapshot_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t mac_requests_drained = PTHREAD_COND_INITIALIZER;
 
 /*------------------------------------------------------------------------------
  * Static Function Declarations
@@ -64,49 +217,341 @@ static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 static void print_mac(unsigned char *mac);
 
 /**
- * @brief Flood a packet to all active ports.
+ * @brief Flood a frame to all active ports of an instance.
+ *        The frame is not copied, every egress queue takes a reference on it.
  *
- * @param incoming_port_index The port the packet came in on
- * @param frame_buffer The frame buffer to send
- * @param len The length of the frame buffer
+ * @param sw The switch instance
+ * @param frame The frame to flood
  */
-static void flood_packet(uint8_t incoming_port_index, unsigned char *frame_buffer, size_t len);
+static void flood_frame(switch_t *sw, frame_t *frame);
 
 /**
- * @brief The main function for the switch thread.
+ * @brief Queue a frame for TX on a port.
+ *        Takes a reference on the frame, the caller keeps its own.
  *
+ * @param sw The switch instance
+ * @param outgoing_port_index The egress port (0-based)
+ * @param frame The frame to queue
  */
-static void *switch_thread_func();
+static void enqueue_frame(switch_t *sw, int outgoing_port_index, frame_t *frame);
 
 /**
- * @brief Process any pending port connect requests.
+ * @brief Send all frames queued on one port and release them.
  *
- * @param fds The pollfd struct to update
+ * @param sw The switch instance
+ * @param port The egress port (0-based)
  */
-static void process_pending_port_requests(struct pollfd *fds);
+static void flush_tx_queue(switch_t *sw, int port);
 
 /**
- * @brief Process an incoming frame.
+ * @brief Send all frames queued on the ports of an instance and release them.
+ *
+ * @param sw The switch instance
+ */
+static void flush_tx_queues(switch_t *sw);
+
+/**
+ * @brief Drop all frames queued on a port.
+ *
+ * @param port The port info struct
+ */
+static void drop_tx_queue(switch_port_info_t *port);
+
+/**
+ * @brief Record the time a frame spent inside the switch.
+ *        Called right before the frame is submitted for TX.
+ *
+ * @param sw The switch instance
+ * @param outgoing_port_index The egress port (0-based)
+ * @param path The forwarding path the frame took
+ * @param rx_ts The kernel RX timestamp of the frame (zero if unavailable)
+ */
+static void record_latency(switch_t *sw, int outgoing_port_index, switch_path_t path, const struct timespec *rx_ts);
+
+/**
+ * @brief The main function for a worker thread.
+ *
+ * @param arg The worker (switch_worker_t *)
+ */
+static void *switch_thread_func(void *arg);
+
+/**
+ * @brief The worker loop of the poll() + recvmsg()/write() backend.
+ *
+ * @param worker The worker
+ */
+static void poll_worker_loop(switch_worker_t *worker);
+
+/**
+ * @brief The worker loop of the io_uring backend.
+ *
+ * @param worker The worker
+ */
+static void uring_worker_loop(switch_worker_t *worker);
+
+/**
+ * @brief Handle all CLI requests for a worker with the lock held.
+ *
+ * @param worker The worker
+ * @param owners Filled with the instances served by the worker
+ * @param fds The pollfd structs to update (MAX_PORTS per instance), or NULL
+ * @return The number of instances in owners
+ */
+static int process_pending_requests(switch_worker_t *worker, switch_t **owners, struct pollfd *fds);
+
+/**
+ * @brief Tell a worker the CLI queued work for it. Must be called with the lock held,
+ *        after the request is in place.
+ *
+ * @param worker The worker
+ */
+static void notify_worker(switch_worker_t *worker);
+
+/**
+ * @brief Apply the static MAC changes the CLI queued for an instance.
+ *
+ * @param sw The switch instance
+ */
+static void process_pending_mac_requests(switch_t *sw);
+
+/**
+ * @brief Queue a static MAC change for the Switch Engine, or apply it directly
+ *        if no worker serves the instance. Waits while the queue is full.
+ *        Must be called with the lock held.
+ *
+ * @param sw The switch instance
+ * @param mac The MAC address
+ * @param port_index Port of the static entry (0-based), or -1 to remove it
+ */
+static void queue_mac_request(switch_t *sw, const unsigned char *mac, int port_index);
+
+/**
+ * @brief Once a second: expire unconfirmed provisional MAC entries and,
+ *        when due, copy the MAC tables for the snapshot thread.
+ *
+ * @param worker The worker
+ * @param owners The instances served by the worker
+ * @param num_instances The number of instances in owners
+ */
+static void process_housekeeping(switch_worker_t *worker, switch_t **owners, int num_instances);
+
+/**
+ * @brief Build the snapshot file path of an instance.
+ *
+ * @param name Name of the instance
+ * @param path Buffer for the path
+ * @param len Size of the buffer
+ */
+static void snapshot_path(const char *name, char *path, size_t len);
+
+/**
+ * @brief Check an instance name: 1 to SWITCH_NAME_LEN - 1 characters out of
+ *        [A-Za-z0-9_-]. The name ends up in the snapshot file path, so it must
+ *        not be able to leave the snapshot directory.
+ *
+ * @param name Name of the instance
+ * @return true if the name is valid
+ */
+static bool valid_switch_name(const char *name);
+
+/**
+ * @brief The main function for the snapshot thread.
+ *        Writes the MAC table copies made by the workers to disk, outside the data path.
+ *
+ * @param arg Unused
+ */
+static void *snapshot_thread_func(void *arg);
+
+/**
+ * @brief Compile the ACL of a port, swap it in and free the replaced
+ *        classifier once no lookup can still be using it.
+ *
+ * @param sw The switch instance
+ * @param port_index The port index (0-based)
+ * @return 0 on success, -1 on allocation failure
+ */
+static int publish_acl(switch_t *sw, int port_index);
+
+/**
+ * @brief Wait until a worker has no ACL lookup in flight that started before now:
+ *        it is blocked waiting for frames, or has moved on to its next wait.
+ *
+ * @param worker The worker
+ */
+static void wait_for_quiescence(switch_worker_t *worker);
+
+/**
+ * @brief Free the ACL tables and classifiers of an instance.
+ *        Its worker must have let go of it.
+ *
+ * @param sw The switch instance
+ */
+static void free_acls(switch_t *sw);
+
+/**
+ * @brief Decide whether the next wait should spin or block, and count it.
+ *
+ * @param worker The worker
+ * @param last_frame_us Time the last frame was received
+ * @return true to spin
+ */
+static bool should_spin(switch_worker_t *worker, uint64_t last_frame_us);
+
+/**
+ * @brief Account the time since the last wait as busy, and the wait that
+ *        just returned as spinning or blocked.
+ *
+ * @param worker The worker
+ * @param spin true if the wait had a zero timeout
+ * @param wait_start_us When the wait started
+ */
+static void account_wait(switch_worker_t *worker, bool spin, uint64_t wait_start_us);
+
+/**
+ * @brief Process any pending port connect requests of an instance.
+ *
+ * @param sw The switch instance
+ * @param fds The pollfd structs of the instance (MAX_PORTS entries) to update, or NULL
+ */
+static void process_pending_port_requests(switch_t *sw, struct pollfd *fds);
+
+/**
+ * @brief Create the worker's io_uring and its provided buffer ring.
+ *
+ * @param worker The worker
+ * @return 0 on success, -1 if io_uring is not available
+ */
+static int uring_worker_setup(switch_worker_t *worker);
+
+/**
+ * @brief Destroy the worker's io_uring and return its buffers to the pool.
+ *
+ * @param worker The worker
+ */
+static void uring_worker_teardown(switch_worker_t *worker);
+
+/**
+ * @brief Get an SQE, submitting what is queued if the submission queue is full.
+ *
+ * @param worker The worker
+ * @return The SQE, or NULL if the queue is still full
+ */
+static struct io_uring_sqe *uring_get_sqe_or_flush(switch_worker_t *worker);
+
+/**
+ * @brief Give a connected port a slot so the worker starts receiving on it.
+ *
+ * @param worker The worker
+ * @param sw The switch instance
+ * @param port_index The index of the port (0-based)
+ */
+static void uring_attach_port(switch_worker_t *worker, switch_t *sw, int port_index);
+
+/**
+ * @brief Cancel the multishot recv of a port and release its slot.
+ *
+ * @param worker The worker
+ * @param port The port info struct
+ */
+static void uring_detach_port(switch_worker_t *worker, switch_port_info_t *port);
+
+/**
+ * @brief Queue the cancel of the multishot recv left over from the slot's
+ *        previous generation.
+ *
+ * @param worker The worker
+ * @param slot_index Index of the slot
+ * @return true if the cancel was queued, false if no SQE was free
+ */
+static bool uring_cancel_recv(switch_worker_t *worker, int slot_index);
+
+/**
+ * @brief (Re-)arm a multishot recv on every attached port that has none, and
+ *        retry the cancels that found the SQ full.
+ *
+ * @param worker The worker
+ */
+static void uring_arm_ports(switch_worker_t *worker);
+
+/**
+ * @brief Put fresh pool frames behind the provided buffers the kernel consumed.
+ *
+ * @param worker The worker
+ */
+static void uring_refill_buffers(switch_worker_t *worker);
+
+/**
+ * @brief Handle all available completions.
+ *
+ * @param worker The worker
+ * @return The number of frames received
+ */
+static int uring_reap_completions(switch_worker_t *worker);
+
+/**
+ * @brief Handle a multishot recvmsg completion.
+ *
+ * @param worker The worker
+ * @param cqe The completion
+ * @return 1 if a frame was received, 0 otherwise
+ */
+static int uring_handle_recv(switch_worker_t *worker, struct io_uring_cqe *cqe);
+
+/**
+ * @brief Drop the instances the CLI asked to stop from a worker.
+ *        Closes their ports and wakes up the waiting CLI.
+ *
+ * @param worker The worker
+ */
+static void process_pending_stop_requests(switch_worker_t *worker);
+
+/**
+ * @brief Read up to RX_BATCH frames from a port into pool frames and forward them.
  *
+ * @param worker The worker serving the instance
+ * @param sw The switch instance
  * @param incoming_port_index The index of the incoming port (0-based)
  */
-static void process_incoming_frame(int incoming_port_index);
+static void receive_frames(switch_worker_t *worker, switch_t *sw, int incoming_port_index);
+
+/**
+ * @brief Process an incoming frame.
+ *
+ * @param sw The switch instance
+ * @param frame The received frame
+ */
+static void process_incoming_frame(switch_t *sw, frame_t *frame);
 
 /**
  * @brief Disconnect a port.
  *
- * @param port The port info struct
+ * @param sw The switch instance
  * @param port_index The index of the port (0-based)
  */
-static void disconnect_port(switch_port_info_t *port, int port_index);
+static void disconnect_port(switch_t *sw, int port_index);
 
 /**
  * @brief Connect a port.
  *
- * @param port The port info struct
+ * @param sw The switch instance
  * @param port_index The index of the port (0-based)
  */
-static void connect_port(switch_port_info_t *port, int port_index);
+static void connect_port(switch_t *sw, int port_index);
+
+/**
+ * @brief Apply a latency config change requested by the CLI.
+ *        Pins (or unpins) the worker thread and updates busy polling on its open sockets.
+ *
+ * @param worker The worker
+ */
+static void process_pending_latency_request(switch_worker_t *worker);
+
+/**
+ * @brief Get the current time of the monotonic clock in microseconds.
+ *
+ * @return The current time in microseconds
+ */
+static uint64_t now_us(void);
 
 /*------------------------------------------------------------------------------
  * Static Functions
@@ -116,75 +561,269 @@ static void print_mac(unsigned char *mac) {
            mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
-static void flood_packet(uint8_t incoming_port_index, unsigned char *frame_buffer, size_t len) {
+static void record_latency(switch_t *sw, int outgoing_port_index, switch_path_t path, const struct timespec *rx_ts) {
+    if (rx_ts->tv_sec == 0 && rx_ts->tv_nsec == 0) {
+        return; // No kernel timestamp, nothing to compare against
+    }
+
+    // SO_TIMESTAMPNS stamps are CLOCK_REALTIME
+    struct timespec tx_ts;
+    clock_gettime(CLOCK_REALTIME, &tx_ts);
+
+    int64_t delta_ns = (int64_t)(tx_ts.tv_sec - rx_ts->tv_sec) * 1000000000 + (tx_ts.tv_nsec - rx_ts->tv_nsec);
+    if (delta_ns < 0) {
+        return; // Clock stepped backwards
+    }
+
+    latency_hist_record(&sw->latency_hist[outgoing_port_index][path], (uint64_t)delta_ns);
+}
+
+static void flood_frame(switch_t *sw, frame_t *frame) {
     printf("Flooding...\n");
+    frame->meta.path = PATH_FLOOD;
     for (int port = 0; port < MAX_PORTS; port++) {
-        if (port != incoming_port_index && switch_inst.port[port].is_active) {
-            if (write(switch_inst.port[port].socket_fd, frame_buffer, len) < 0) {
-                perror("Send on port failed");
-            } else {
-                printf("[Port %d] Sent %zu bytes to port %d\n", incoming_port_index + 1, len, port + 1);
+        if (port != frame->meta.ingress_port && sw->port[port].is_active) {
+            enqueue_frame(sw, port, frame);
+        }
+    }
+}
+
+static void enqueue_frame(switch_t *sw, int outgoing_port_index, frame_t *frame) {
+    switch_tx_queue_t *queue = &sw->port[outgoing_port_index].tx_queue;
+
+    /* One round can queue up to (MAX_PORTS - 1) * RX_BATCH frames on a port.
+     * Send what we have rather than drop: the write() backpressure of the
+     * unbatched path is kept, the batch is just smaller.
+     */
+    if (queue->count == TX_QUEUE_DEPTH) {
+        flush_tx_queue(sw, outgoing_port_index);
+    }
+
+    frame_get(frame);
+    queue->frames[queue->count++] = frame;
+}
+
+static void flush_tx_queue(switch_t *sw, int port) {
+    switch_worker_t *worker = sw->worker;
+    switch_tx_queue_t *queue = &sw->port[port].tx_queue;
+
+    for (int i = 0; i < queue->count; i++) {
+        frame_t *frame = queue->frames[i];
+
+        record_latency(sw, port, frame->meta.path, &frame->meta.rx_ts);
+
+        /* With io_uring the send is only queued here. All sends of the round go
+         * to the kernel in the next io_uring_enter(), and the frame reference
+         * is dropped when the send completes.
+         */
+        if (worker->backend == SWITCH_BACKEND_URING) {
+            struct io_uring_sqe *sqe = uring_get_sqe_or_flush(worker);
+            if (sqe == NULL) {
+                queue->drops++;
+                frame_put(frame);
+                continue;
             }
+            uring_prep_send(sqe, sw->port[port].socket_fd, frame_data(frame), frame->meta.len,
+                            (URING_OP_SEND << URING_OP_SHIFT) | (uintptr_t)frame);
+            printf("[%s][Port %d] Submitted %d bytes to port %d\n", sw->name, frame->meta.ingress_port + 1, frame->meta.len, port + 1);
+            continue;
+        }
+
+        if (write(sw->port[port].socket_fd, frame_data(frame), frame->meta.len) < 0) {
+            perror("Send on port failed");
+        } else {
+            printf("[%s][Port %d] Sent %d bytes to port %d\n", sw->name, frame->meta.ingress_port + 1, frame->meta.len, port + 1);
         }
+        frame_put(frame);
+    }
+    queue->count = 0;
+}
+
+static void flush_tx_queues(switch_t *sw) {
+    for (int port = 0; port < MAX_PORTS; port++) {
+        flush_tx_queue(sw, port);
+    }
+}
+
+static void drop_tx_queue(switch_port_info_t *port) {
+    for (int i = 0; i < port->tx_queue.count; i++) {
+        frame_put(port->tx_queue.frames[i]);
     }
+    port->tx_queue.count = 0;
 }
 
-static void disconnect_port(switch_port_info_t *port, int port_index) {
+static void disconnect_port(switch_t *sw, int port_index) {
+    switch_port_info_t *port = &sw->port[port_index];
+
+    drop_tx_queue(port);
+    if (port->uring_slot != -1) {
+        uring_detach_port(sw->worker, port);
+    }
+    /* The sends queued last round name the socket by fd number and would only
+     * reach the kernel at the next io_uring_enter(). Submit them now, while the
+     * number still means this socket: a connect later in this pass may be
+     * handed the same number for another interface.
+     */
+    if (sw->worker->backend == SWITCH_BACKEND_URING) {
+        uring_submit_and_wait(&sw->worker->ring, 0, 0);
+    }
     socket_close(port->socket_fd);
     port->socket_fd = -1;
     port->is_active = false;
-    mac_table_flush_port(port_index);
-    printf("[Switch Engine] Port %d disconnected.\n", port_index + 1);
+    mac_table_flush_port(&sw->mac_table, port_index);
+    printf("[Switch Engine] %s: Port %d disconnected.\n", sw->name, port_index + 1);
 }
 
-static void connect_port(switch_port_info_t *port, int port_index) {
+static void connect_port(switch_t *sw, int port_index) {
+    switch_port_info_t *port = &sw->port[port_index];
+
     int new_sock = create_socket(port->pending_name);
     if (new_sock >= 0) {
         port->socket_fd = new_sock;
         strncpy(port->if_name, port->pending_name, IFNAMSIZ);
         port->is_active = true;
-        printf("[Switch Engine] Port %d connected to %s and is UP.\n", port_index + 1, port->pending_name);
+        socket_enable_rx_timestamps(new_sock);
+        socket_enable_vlan_info(new_sock);
+        if (latency_config.busy_poll) {
+            socket_set_busy_poll(new_sock, BUSY_POLL_SOCKET_US);
+        }
+        if (sw->worker->backend == SWITCH_BACKEND_URING) {
+            uring_attach_port(sw->worker, sw, port_index);
+        }
+        printf("[Switch Engine] %s: Port %d connected to %s and is UP.\n", sw->name, port_index + 1, port->pending_name);
     }
 }
 
-static void process_pending_port_requests(struct pollfd *fds) {
+static void process_pending_port_requests(switch_t *sw, struct pollfd *fds) {
     for (int i = 0; i < MAX_PORTS; i++) {
         // Check if CLI asked to connect a port
-        if (switch_inst.port[i].request_connect) {
+        if (sw->port[i].request_connect) {
             // Close old socket if it was open
-            if (switch_inst.port[i].socket_fd != -1) {
-                disconnect_port(&switch_inst.port[i], i);
+            if (sw->port[i].socket_fd != -1) {
+                disconnect_port(sw, i);
             }
-            connect_port(&switch_inst.port[i], i);
-            switch_inst.port[i].request_connect = false; // Request handled
-        } else if (switch_inst.port[i].request_disconnect) {
-            disconnect_port(&switch_inst.port[i], i);
-            switch_inst.port[i].request_disconnect = false; // Request handled
+            connect_port(sw, i);
+            sw->port[i].request_connect = false; // Request handled
+        } else if (sw->port[i].request_disconnect) {
+            disconnect_port(sw, i);
+            sw->port[i].request_disconnect = false; // Request handled
         }
 
         // Update poll struct
-        fds[i].fd = switch_inst.port[i].socket_fd;
-        fds[i].events = POLLIN;
+        if (fds != NULL) {
+            fds[i].fd = sw->port[i].socket_fd;
+            fds[i].events = POLLIN;
+        }
     }
 }
 
-static void process_incoming_frame(int incoming_port_index) {
+static void process_pending_stop_requests(switch_worker_t *worker) {
+    for (int i = 0; i < worker->num_instances; i++) {
+        switch_t *sw = worker->instances[i];
+        if (!sw->request_stop) {
+            continue;
+        }
+
+        for (int port = 0; port < MAX_PORTS; port++) {
+            if (sw->port[port].socket_fd != -1) {
+                disconnect_port(sw, port);
+            }
+        }
 
-    int len = recvfrom(switch_inst.port[incoming_port_index].socket_fd,
-                        &switch_inst.frame_buffer, sizeof(switch_inst.frame_buffer), 0, NULL, NULL);
-    ethernet_header_t *header = (ethernet_header_t *)switch_inst.frame_buffer;
+        // Swap with last instance and shrink the list
+        worker->instances[i] = worker->instances[worker->num_instances - 1];
+        worker->num_instances--;
+        i--; // Re-check this index since we swapped in a new instance
 
-    if (len < 0) {
-        perror("Receive failed");
-        return;
+        sw->worker = NULL;
+        sw->request_stop = false; // Request handled
+        pthread_cond_broadcast(&instance_stopped);
     }
+}
 
-    // Ignore ipv6
-    if (ntohs(header->ether_type) == ETH_TYPE_IPV6) {
+static void process_pending_latency_request(switch_worker_t *worker) {
+    if (worker->latency_generation == latency_config.generation) {
         return;
     }
+    worker->latency_generation = latency_config.generation; // Request handled
+    worker->busy_poll = latency_config.busy_poll;
+    worker->idle_us = latency_config.idle_us;
+
+    if (latency_config.busy_poll) {
+        int cpu = latency_config.cpu + worker->index;
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            printf("[Switch Engine] Worker %d failed to pin to CPU %d, busy polling unpinned.\n", worker->index, cpu);
+        }
+    } else {
+        pthread_setaffinity_np(pthread_self(), sizeof(worker->default_affinity), &worker->default_affinity);
+    }
+
+    for (int i = 0; i < worker->num_instances; i++) {
+        switch_t *sw = worker->instances[i];
+        for (int port = 0; port < MAX_PORTS; port++) {
+            if (sw->port[port].is_active) {
+                socket_set_busy_poll(sw->port[port].socket_fd, latency_config.busy_poll ? BUSY_POLL_SOCKET_US : 0);
+            }
+        }
+    }
+
+    if (latency_config.busy_poll) {
+        printf("[Switch Engine] Worker %d busy-poll mode on CPU %d (idle fallback after %d us).\n",
+               worker->index, latency_config.cpu + worker->index, latency_config.idle_us);
+    } else {
+        printf("[Switch Engine] Worker %d blocking poll mode.\n", worker->index);
+    }
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void receive_frames(switch_worker_t *worker, switch_t *sw, int incoming_port_index) {
+    for (int i = 0; i < RX_BATCH; i++) {
+        frame_t *frame = frame_alloc();
+        if (frame == NULL) {
+            worker->stats.pool_empty++;
+            return; // Frames stay in the socket queue until TX frees some
+        }
+
+        ssize_t len = socket_recv_frame(sw->port[incoming_port_index].socket_fd, frame_data(frame), FRAME_DATA_MAX,
+                                        &frame->meta.rx_ts, &frame->meta.vlan_tci);
+        if (len < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Receive failed");
+            }
+            frame_put(frame);
+            return; // Socket drained
+        }
+
+        frame->meta.len = (uint16_t)len;
+        frame->meta.ingress_port = (int8_t)incoming_port_index;
+        process_incoming_frame(sw, frame);
+        frame_put(frame); // Drop the RX reference, the egress queues hold their own
+    }
+}
+
+static void process_incoming_frame(switch_t *sw, frame_t *frame) {
+    int incoming_port_index = frame->meta.ingress_port;
+    ethernet_header_t *header = (ethernet_header_t *)frame_data(frame);
+    acl_verdict_t verdict = {.drop = false, .mirror_port = -1};
+
+    // Pairs with the store in publish_acl(), the CLI may swap it at any time
+    acl_classifier_t *acl = __atomic_load_n(&sw->port[incoming_port_index].acl, __ATOMIC_SEQ_CST);
+    if (acl != NULL) {
+        verdict = acl_classify(acl, frame_data(frame), frame->meta.len, frame->meta.vlan_tci);
+        if (verdict.drop) {
+            return; // Denied or over the rate, dropped before MAC learning
+        }
+    }
 
-    printf("PORT %d:\n", incoming_port_index + 1);
+    printf("[%s] PORT %d:\n", sw->name, incoming_port_index + 1);
     printf("Source MAC: ");
     print_mac(header->src_mac);
 
@@ -194,59 +833,563 @@ static void process_incoming_frame(int incoming_port_index) {
 
     printf("Ether Type: 0x%04x\n", ntohs(header->ether_type));
 
-    mac_table_update(header->src_mac, incoming_port_index);
+    mac_table_update(&sw->mac_table, header->src_mac, incoming_port_index);
 
-    int8_t outgoing_port_index = mac_table_lookup_port(header->dst_mac);
-    if (outgoing_port_index == -1 || !switch_inst.port[outgoing_port_index].is_active) {
-        flood_packet(incoming_port_index, switch_inst.frame_buffer, len);
+    int8_t outgoing_port_index = mac_table_lookup_port(&sw->mac_table, header->dst_mac);
+    if (outgoing_port_index == -1 || !sw->port[outgoing_port_index].is_active) {
+        flood_frame(sw, frame);
     } else {
         printf("Sending to Port %d\n", outgoing_port_index + 1);
-        if (write(switch_inst.port[outgoing_port_index].socket_fd, switch_inst.frame_buffer, len) < 0) {
-            perror("Send failed");
-        } else {
-            printf("[Port %d] Sent %d bytes to port %d\n", incoming_port_index + 1, len, outgoing_port_index + 1);
+        frame->meta.path = PATH_UNICAST;
+        enqueue_frame(sw, outgoing_port_index, frame);
+
+        // A flooded frame already reaches the mirror port
+        int mirror = verdict.mirror_port;
+        if (mirror != -1 && mirror != outgoing_port_index && mirror != incoming_port_index && sw->port[mirror].is_active) {
+            printf("Mirroring to Port %d\n", mirror + 1);
+            enqueue_frame(sw, mirror, frame);
         }
     }
     printf("--------------------------------\n");
 }
 
-static void *switch_thread_func() {
-    struct pollfd fds[MAX_PORTS];
-
-    /*
-     * The poll() function below converts "simultaneous" events into a sequential
-     * "To-Do List." If two packets arrive at the exact same nanosecond:
-     * 1. poll() wakes up indicating both ports have data.
-     * 2. We process Port 1's packet first.
-     * 3. We process Port 2's packet immediately after.
+static int process_pending_requests(switch_worker_t *worker, switch_t **owners, struct pollfd *fds) {
+    /* A busy-polling worker gets here on every spin. Taking the lock each time
+     * would bounce its cache line between all spinning cores, so only take it
+     * when the CLI queued something or the housekeeping is due. owners and fds
+     * still hold what the last locked round put there.
      */
-     while (!switch_inst.shutdown) {
+    unsigned generation = __atomic_load_n(&worker->request_generation, __ATOMIC_ACQUIRE);
+    if (generation == worker->handled_generation && (time_t)(now_us() / 1000000) == worker->last_housekeeping_s) {
+        return worker->num_owners;
+    }
+    worker->handled_generation = generation;
 
-        pthread_mutex_lock(&lock); // Grab the key
-        process_pending_port_requests(fds);
-        pthread_mutex_unlock(&lock); // Release the key
+    pthread_mutex_lock(&lock); // Grab the key
+    process_pending_stop_requests(worker);
+    int num_instances = worker->num_instances;
+    for (int i = 0; i < num_instances; i++) {
+        owners[i] = worker->instances[i];
+        process_pending_port_requests(owners[i], fds != NULL ? &fds[i * MAX_PORTS] : NULL);
+        process_pending_mac_requests(owners[i]);
+    }
+    process_pending_latency_request(worker);
+    process_housekeeping(worker, owners, num_instances);
+    pthread_mutex_unlock(&lock); // Release the key
 
-        /* poll() blocks until data arrives on ANY of the ports
-         * Timeout = 1000ms. If no packets arrive, wake up anyway to check for CLI commands.
-         */
-        int ret = poll(fds, MAX_PORTS, 1000);
+    worker->num_owners = num_instances;
+    return num_instances;
+}
+
+static void notify_worker(switch_worker_t *worker) {
+    // Pairs with the load in process_pending_requests()
+    __atomic_add_fetch(&worker->request_generation, 1, __ATOMIC_RELEASE);
+}
+
+static void process_pending_mac_requests(switch_t *sw) {
+    if (sw->num_mac_requests == 0) {
+        return;
+    }
+
+    for (int i = 0; i < sw->num_mac_requests; i++) {
+        mac_request_t *request = &sw->mac_requests[i];
+
+        if (request->port_index == -1) {
+            if (mac_table_remove_static(&sw->mac_table, request->mac) == 0) {
+                printf("[Switch Engine] %s: Static MAC ", sw->name);
+                print_mac(request->mac);
+                printf(" removed.\n");
+            }
+        } else if (mac_table_add_static(&sw->mac_table, request->mac, request->port_index) == 0) {
+            printf("[Switch Engine] %s: Static MAC ", sw->name);
+            print_mac(request->mac);
+            printf(" on Port %d.\n", request->port_index + 1);
+        } else {
+            printf("[Switch Engine] %s: Table full! Cannot add static MAC.\n", sw->name);
+        }
+    }
+    sw->num_mac_requests = 0; // Requests handled
+    pthread_cond_broadcast(&mac_requests_drained);
+}
+
+static void queue_mac_request(switch_t *sw, const unsigned char *mac, int port_index) {
+    // A config file can queue entries much faster than one round drains them
+    while (sw->worker != NULL && sw->num_mac_requests == MAC_REQUEST_QUEUE) {
+        pthread_cond_wait(&mac_requests_drained, &lock);
+    }
+
+    mac_request_t *request = &sw->mac_requests[sw->num_mac_requests++];
+    memcpy(request->mac, mac, MAC_ADDR_LEN);
+    request->port_index = port_index;
+
+    // Not started: nobody else touches the table, apply it right away
+    if (sw->worker == NULL) {
+        process_pending_mac_requests(sw);
+    } else {
+        notify_worker(sw->worker);
+    }
+}
+
+static void process_housekeeping(switch_worker_t *worker, switch_t **owners, int num_instances) {
+    time_t now = (time_t)(now_us() / 1000000);
+
+    if (now == worker->last_housekeeping_s) {
+        return;
+    }
+    worker->last_housekeeping_s = now;
+
+    for (int i = 0; i < num_instances; i++) {
+        switch_t *sw = owners[i];
+
+        mac_table_expire_provisional(&sw->mac_table, now);
+
+        // The copy is cheap; the slow file write happens on the snapshot thread
+        if (snapshot_interval_s > 0 && now >= sw->next_snapshot_s) {
+            sw->snapshot = sw->mac_table;
+            sw->snapshot_seq++;
+            sw->next_snapshot_s = now + snapshot_interval_s;
+            pthread_cond_signal(&snapshot_wakeup);
+        }
+    }
+}
+
+static int publish_acl(switch_t *sw, int port_index) {
+    switch_port_info_t *port = &sw->port[port_index];
+    acl_classifier_t *classifier = NULL;
+
+    // Compile outside the lock, forwarding goes on with the old rules meanwhile
+    if (port->acl_rules->count > 0) {
+        classifier = acl_compile(port->acl_rules);
+        if (classifier == NULL) {
+            return -1;
+        }
+    }
+
+    pthread_mutex_lock(&lock);
+    acl_classifier_t *old = port->acl;
+    __atomic_store_n(&port->acl, classifier, __ATOMIC_SEQ_CST);
+    port->acl_dirty = false;
+    switch_worker_t *worker = sw->worker;
+    pthread_mutex_unlock(&lock);
+
+    // Outside the lock: the worker takes it between rounds. Only the CLI stops instances, so worker stays valid
+    if (worker != NULL && old != NULL) {
+        wait_for_quiescence(worker);
+    }
+    acl_classifier_free(old);
+
+    return 0;
+}
+
+static void wait_for_quiescence(switch_worker_t *worker) {
+    /* Sequentially consistent with the pointer swap before us and with the
+     * worker's bump before its next lookup: if the epoch is odd the worker is
+     * blocked and will load the new classifier when it wakes up. If it is even,
+     * a lookup may hold the old one until the worker's next wait.
+     */
+    uint64_t epoch = __atomic_load_n(&worker->quiescent_epoch, __ATOMIC_SEQ_CST);
+    while ((epoch & 1) == 0 && __atomic_load_n(&worker->quiescent_epoch, __ATOMIC_SEQ_CST) == epoch) {
+        sched_yield();
+    }
+}
+
+static void free_acls(switch_t *sw) {
+    for (int port = 0; port < MAX_PORTS; port++) {
+        acl_classifier_free(sw->port[port].acl);
+        acl_table_destroy(sw->port[port].acl_rules);
+    }
+}
+
+static void snapshot_path(const char *name, char *path, size_t len) {
+    snprintf(path, len, "%s/%s.mac", snapshot_dir, name);
+}
+
+static bool valid_switch_name(const char *name) {
+    if (name == NULL || name[0] == '\0' || strlen(name) >= SWITCH_NAME_LEN) {
+        return false;
+    }
+    for (const char *c = name; *c != '\0'; c++) {
+        if (!isalnum((unsigned char)*c) && *c != '_' && *c != '-') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void *snapshot_thread_func(void *arg) {
+    static mac_table_t table; // Only this thread uses it, keep it off the stack
+    char name[SWITCH_NAME_LEN];
+    char path[PATH_MAX + SWITCH_NAME_LEN + 8];
+    (void)arg;
+
+    pthread_mutex_lock(&lock);
+    while (!shutdown_requested) {
+        // Wake up for new copies, or every second to notice shutdown
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        pthread_cond_timedwait(&snapshot_wakeup, &lock, &deadline);
+
+        for (int i = 0; i < MAX_SWITCHES; i++) {
+            switch_t *sw = instances[i];
+            if (sw == NULL || sw->saved_seq == sw->snapshot_seq) {
+                continue;
+            }
+
+            // Copy out what we need, the instance may be deleted while we write
+            table = sw->snapshot;
+            strcpy(name, sw->name);
+            sw->saved_seq = sw->snapshot_seq;
+
+            pthread_mutex_unlock(&lock);
+            snapshot_path(name, path, sizeof(path));
+            mac_table_save(&table, path);
+            pthread_mutex_lock(&lock);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+static bool should_spin(switch_worker_t *worker, uint64_t last_frame_us) {
+    /* In busy-poll mode we spin (timeout = 0) as long as frames keep arriving,
+     * which saves the wakeup and context switch on every burst. Once the ports
+     * have been idle for idle_us we fall back to blocking so the core is not
+     * burned forever on a quiet switch.
+     */
+    bool spin = worker->busy_poll && (now_us() - last_frame_us) < (uint64_t)worker->idle_us;
+
+    worker->stats.spinning = spin;
+    return spin;
+}
+
+static void account_wait(switch_worker_t *worker, bool spin, uint64_t wait_start_us) {
+    uint64_t now = now_us();
+    switch_stats_t *stats = &worker->stats;
+
+    /* Count time, not calls: a spin returns in microseconds while a blocking
+     * wait can last a second, so only time says how much CPU the mode burns.
+     */
+    stats->busy_us += wait_start_us - stats->last_wake_us;
+    if (spin) {
+        stats->spin_us += now - wait_start_us;
+    } else {
+        stats->blocked_us += now - wait_start_us;
+    }
+    stats->last_wake_us = now;
+}
+
+static void poll_worker_loop(switch_worker_t *worker) {
+    struct pollfd fds[MAX_SWITCHES * MAX_PORTS];
+    switch_t *fd_owner[MAX_SWITCHES]; // Instance behind each block of MAX_PORTS pollfds
+    uint64_t last_frame_us = 0;
+
+    worker->stats.last_wake_us = now_us();
+
+    /*
+     * The poll() function below converts "simultaneous" events into a sequential
+     * "To-Do List." If two packets arrive at the exact same nanosecond:
+     * 1. poll() wakes up indicating both ports have data.
+     * 2. We process Port 1's packet first.
+     * 3. We process Port 2's packet immediately after.
+     * The same holds across instances: each instance owns a block of MAX_PORTS
+     * entries in fds, so one poll() covers every bridge served by this worker.
+     */
+    while (!shutdown_requested) {
+        int num_instances = process_pending_requests(worker, fd_owner, fds);
+        bool spin = should_spin(worker, last_frame_us);
+
+        /* poll() blocks until data arrives on ANY of the ports
+         * Timeout = 1000ms. If no packets arrive, wake up anyway to check for CLI commands.
+         */
+        uint64_t wait_start_us = now_us();
+        __atomic_add_fetch(&worker->quiescent_epoch, 1, __ATOMIC_SEQ_CST);
+        int ret = poll(fds, num_instances * MAX_PORTS, spin ? 0 : POLL_TIMEOUT_MS);
+        __atomic_add_fetch(&worker->quiescent_epoch, 1, __ATOMIC_SEQ_CST);
+        account_wait(worker, spin, wait_start_us);
 
         if (ret <= 0) {
             continue;
         }
+        last_frame_us = now_us();
 
-        // Check which port has data
-        for (int incoming_port_index = 0; incoming_port_index < MAX_PORTS; incoming_port_index++) {
-            if (fds[incoming_port_index].revents & POLLIN) {
-                process_incoming_frame(incoming_port_index);
+        for (int i = 0; i < num_instances; i++) {
+            switch_t *sw = fd_owner[i];
+
+            // Check which port has data
+            for (int incoming_port_index = 0; incoming_port_index < MAX_PORTS; incoming_port_index++) {
+                if (fds[i * MAX_PORTS + incoming_port_index].revents & POLLIN) {
+                    receive_frames(worker, sw, incoming_port_index);
+                }
             }
+
+            // Send everything the RX pass queued up
+            flush_tx_queues(sw);
         }
     }
+}
 
-    // Clean up
-    for (int port = 0; port < MAX_PORTS; port++) {
-        if (switch_inst.port[port].socket_fd != -1)
-            socket_close(switch_inst.port[port].socket_fd);
+/* ---------------- io_uring Backend ---------------- */
+static int uring_worker_setup(switch_worker_t *worker) {
+    if (uring_init(&worker->ring, URING_ENTRIES) < 0) {
+        return -1;
+    }
+
+    // Needs kernel >= 5.19, multishot recvmsg below needs >= 6.0
+    if (uring_setup_buf_ring(&worker->ring, URING_BUF_ENTRIES, URING_BUF_GROUP) < 0) {
+        uring_exit(&worker->ring);
+        return -1;
+    }
+
+    // No address, room for the RX timestamp control message
+    memset(&worker->recv_msg, 0, sizeof(worker->recv_msg));
+    worker->recv_msg.msg_controllen = SOCKET_RX_CONTROL_LEN;
+
+    // All buffer ids start empty, the first refill hands them to the kernel
+    for (int bid = 0; bid < URING_BUF_ENTRIES; bid++) {
+        worker->buf_frames[bid] = NULL;
+        worker->empty_bids[bid] = (uint16_t)bid;
+    }
+    worker->num_empty_bids = URING_BUF_ENTRIES;
+
+    for (int i = 0; i < MAX_SWITCHES * MAX_PORTS; i++) {
+        worker->slots[i].sw = NULL;
+        worker->slots[i].cancel_pending = false;
+    }
+
+    return 0;
+}
+
+static void uring_worker_teardown(switch_worker_t *worker) {
+    // Closing the ring cancels everything still in flight
+    uring_exit(&worker->ring);
+
+    for (int bid = 0; bid < URING_BUF_ENTRIES; bid++) {
+        if (worker->buf_frames[bid] != NULL) {
+            frame_put(worker->buf_frames[bid]);
+            worker->buf_frames[bid] = NULL;
+        }
+    }
+}
+
+static struct io_uring_sqe *uring_get_sqe_or_flush(switch_worker_t *worker) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&worker->ring);
+
+    if (sqe == NULL) {
+        uring_submit_and_wait(&worker->ring, 0, 0);
+        sqe = uring_get_sqe(&worker->ring);
+    }
+    return sqe;
+}
+
+static void uring_attach_port(switch_worker_t *worker, switch_t *sw, int port_index) {
+    for (int i = 0; i < MAX_SWITCHES * MAX_PORTS; i++) {
+        uring_port_slot_t *slot = &worker->slots[i];
+        if (slot->sw == NULL && !slot->cancel_pending) {
+            slot->sw = sw;
+            slot->port_index = port_index;
+            slot->armed = false; // Armed by uring_arm_ports() after the lock is dropped
+            sw->port[port_index].uring_slot = i;
+            return;
+        }
+    }
+}
+
+static bool uring_cancel_recv(switch_worker_t *worker, int slot_index) {
+    uring_port_slot_t *slot = &worker->slots[slot_index];
+    uint16_t generation = (uint16_t)(slot->generation - 1);
+    uint64_t recv_data = (URING_OP_RECV << URING_OP_SHIFT) | ((uint64_t)generation << 32) | (uint32_t)slot_index;
+
+    struct io_uring_sqe *sqe = uring_get_sqe_or_flush(worker);
+    if (sqe == NULL) {
+        return false;
+    }
+    uring_prep_cancel(sqe, recv_data, URING_OP_CANCEL << URING_OP_SHIFT);
+    return true;
+}
+
+static void uring_detach_port(switch_worker_t *worker, switch_port_info_t *port) {
+    uring_port_slot_t *slot = &worker->slots[port->uring_slot];
+    bool was_armed = slot->armed;
+
+    // Anything the old recv still completes now carries a stale generation
+    slot->sw = NULL;
+    slot->armed = false;
+    slot->generation++;
+
+    /* Left alive, the recv would keep the closed socket open and eat provided
+     * buffers. If the SQ is full, uring_arm_ports() retries the cancel, and
+     * the slot is not reused until it has gone out.
+     */
+    if (was_armed) {
+        slot->cancel_pending = !uring_cancel_recv(worker, port->uring_slot);
+    }
+    port->uring_slot = -1;
+}
+
+static void uring_arm_ports(switch_worker_t *worker) {
+    for (int i = 0; i < MAX_SWITCHES * MAX_PORTS; i++) {
+        uring_port_slot_t *slot = &worker->slots[i];
+        if (slot->cancel_pending) {
+            slot->cancel_pending = !uring_cancel_recv(worker, i);
+            continue;
+        }
+        if (slot->sw == NULL || slot->armed) {
+            continue;
+        }
+
+        struct io_uring_sqe *sqe = uring_get_sqe_or_flush(worker);
+        if (sqe == NULL) {
+            return; // Try again next round
+        }
+
+        uint64_t user_data = (URING_OP_RECV << URING_OP_SHIFT) | ((uint64_t)slot->generation << 32) | (uint32_t)i;
+        uring_prep_recvmsg_multishot(sqe, slot->sw->port[slot->port_index].socket_fd, &worker->recv_msg,
+                                     URING_BUF_GROUP, user_data);
+        slot->armed = true;
+    }
+}
+
+static void uring_refill_buffers(switch_worker_t *worker) {
+    if (worker->num_empty_bids == 0) {
+        return;
+    }
+
+    while (worker->num_empty_bids > 0) {
+        frame_t *frame = frame_alloc();
+        if (frame == NULL) {
+            worker->stats.pool_empty++;
+            break; // Retried next round, once TX completions have freed frames
+        }
+
+        uint16_t bid = worker->empty_bids[--worker->num_empty_bids];
+        worker->buf_frames[bid] = frame;
+        uring_buf_ring_add(&worker->ring, frame_data(frame) - URING_RECV_PREFIX,
+                           URING_RECV_PREFIX + FRAME_DATA_MAX, bid);
+    }
+    uring_buf_ring_publish(&worker->ring);
+}
+
+static int uring_handle_recv(switch_worker_t *worker, struct io_uring_cqe *cqe) {
+    uint32_t slot_index = (uint32_t)cqe->user_data;
+    uint16_t generation = (uint16_t)(cqe->user_data >> 32);
+    uring_port_slot_t *slot = &worker->slots[slot_index];
+    bool stale = slot->sw == NULL || slot->generation != generation;
+    frame_t *frame = NULL;
+
+    // The kernel picked one of our buffers, take its frame back
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        frame = worker->buf_frames[bid];
+        worker->buf_frames[bid] = NULL;
+        worker->empty_bids[worker->num_empty_bids++] = bid;
+    }
+
+    // No F_MORE means the multishot recv ended (e.g. ran out of buffers)
+    if (!stale && !(cqe->flags & IORING_CQE_F_MORE)) {
+        slot->armed = false;
+    }
+    if (cqe->res == -ENOBUFS) {
+        worker->stats.pool_empty++;
+    }
+
+    if (frame == NULL) {
+        return 0;
+    }
+
+    int received = 0;
+    if (!stale && cqe->res >= 0) {
+        struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)(frame_data(frame) - URING_RECV_PREFIX);
+        if (!(out->flags & MSG_TRUNC)) {
+            struct msghdr msg = {
+                .msg_control = (char *)(out + 1) + out->namelen,
+                .msg_controllen = out->controllen,
+            };
+            socket_parse_rx_info(&msg, &frame->meta.rx_ts, &frame->meta.vlan_tci);
+
+            frame->meta.len = (uint16_t)out->payloadlen;
+            frame->meta.ingress_port = (int8_t)slot->port_index;
+            process_incoming_frame(slot->sw, frame);
+            received = 1;
+        }
+    }
+
+    frame_put(frame); // Drop the RX reference, the egress queues hold their own
+    return received;
+}
+
+static int uring_reap_completions(switch_worker_t *worker) {
+    struct io_uring_cqe *cqe;
+    int received = 0;
+
+    while ((cqe = uring_peek_cqe(&worker->ring)) != NULL) {
+        uint64_t op = cqe->user_data >> URING_OP_SHIFT;
+
+        if (op == URING_OP_RECV) {
+            received += uring_handle_recv(worker, cqe);
+        } else if (op == URING_OP_SEND) {
+            if (cqe->res < 0) {
+                printf("Send on port failed: %s\n", strerror(-cqe->res));
+            }
+            frame_put((frame_t *)(uintptr_t)(cqe->user_data & URING_PTR_MASK));
+        }
+        uring_cqe_seen(&worker->ring);
+    }
+
+    return received;
+}
+
+static void uring_worker_loop(switch_worker_t *worker) {
+    switch_t *owners[MAX_SWITCHES];
+    uint64_t last_frame_us = 0;
+
+    worker->stats.last_wake_us = now_us();
+
+    while (!shutdown_requested) {
+        int num_instances = process_pending_requests(worker, owners, NULL);
+        uring_refill_buffers(worker);
+        uring_arm_ports(worker);
+        bool spin = should_spin(worker, last_frame_us);
+
+        /* One io_uring_enter() submits everything queued since the last round
+         * (sends, re-armed recvs, cancels) and waits for completions. While
+         * spinning we do not wait, and if nothing is queued there is no syscall
+         * at all: completions are read straight from the shared CQ ring.
+         */
+        uint64_t wait_start_us = now_us();
+        __atomic_add_fetch(&worker->quiescent_epoch, 1, __ATOMIC_SEQ_CST);
+        uring_submit_and_wait(&worker->ring, spin ? 0 : 1, POLL_TIMEOUT_MS);
+        __atomic_add_fetch(&worker->quiescent_epoch, 1, __ATOMIC_SEQ_CST);
+        account_wait(worker, spin, wait_start_us);
+
+        if (uring_reap_completions(worker) > 0) {
+            last_frame_us = now_us();
+        }
+
+        // Queue the sends for everything received this round
+        for (int i = 0; i < num_instances; i++) {
+            flush_tx_queues(owners[i]);
+        }
+    }
+
+    uring_worker_teardown(worker);
+}
+
+static void *switch_thread_func(void *arg) {
+    switch_worker_t *worker = arg;
+
+    pthread_getaffinity_np(pthread_self(), sizeof(worker->default_affinity), &worker->default_affinity);
+
+    if (worker->backend == SWITCH_BACKEND_URING && uring_worker_setup(worker) < 0) {
+        printf("[Switch Engine] Worker %d: io_uring not available (%s), using poll().\n", worker->index, strerror(errno));
+        worker->backend = SWITCH_BACKEND_POLL;
+    }
+
+    if (worker->backend == SWITCH_BACKEND_URING) {
+        uring_worker_loop(worker);
+    } else {
+        poll_worker_loop(worker);
     }
 
     return NULL;
@@ -255,23 +1398,233 @@ static void *switch_thread_func() {
 /*------------------------------------------------------------------------------
  * Public Functions
  *----------------------------------------------------------------------------*/
-void switch_init(void) {
-    memset(&switch_inst, 0, sizeof(switch_inst));
+int switch_system_init(int worker_count, switch_backend_t backend) {
+    if (worker_count < 1 || worker_count > MAX_WORKERS) {
+        return -1;
+    }
+
+    // The only allocation of frame memory, the data path never mallocs
+    if (frame_pool_init(FRAME_POOL_SIZE) < 0) {
+        return -1;
+    }
+
+    shutdown_requested = false;
+    num_workers = worker_count;
+    for (int i = 0; i < num_workers; i++) {
+        memset(&workers[i], 0, sizeof(workers[i]));
+        workers[i].index = i;
+        workers[i].backend = backend;
+        pthread_create(&workers[i].thread_id, NULL, switch_thread_func, &workers[i]);
+    }
+
+    return 0;
+}
+
+void switch_system_shutdown(void) {
+    char path[PATH_MAX + SWITCH_NAME_LEN + 8];
+
+    pthread_mutex_lock(&lock);
+    shutdown_requested = true;
+    pthread_cond_signal(&snapshot_wakeup);
+    pthread_mutex_unlock(&lock);
+
+    if (snapshot_thread_running) {
+        pthread_join(snapshot_thread_id, NULL);
+        snapshot_thread_running = false;
+    }
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i].thread_id, NULL);
+    }
+
+    // Workers are gone, clean up what they left behind
+    for (int i = 0; i < MAX_SWITCHES; i++) {
+        switch_t *sw = instances[i];
+        if (sw == NULL) {
+            continue;
+        }
+
+        // On-exit snapshot, so the next start only has to confirm what we knew
+        if (snapshot_dir[0] != '\0') {
+            snapshot_path(sw->name, path, sizeof(path));
+            mac_table_save(&sw->mac_table, path);
+        }
+
+        for (int port = 0; port < MAX_PORTS; port++) {
+            drop_tx_queue(&sw->port[port]);
+            if (sw->port[port].socket_fd != -1)
+                socket_close(sw->port[port].socket_fd);
+        }
+        free_acls(sw);
+        free(sw);
+        instances[i] = NULL;
+    }
+
+    num_workers = 0;
+    frame_pool_destroy();
+}
+
+switch_t *switch_init(const char *name) {
+    if (!valid_switch_name(name)) {
+        return NULL;
+    }
+
+    // Control path only, the data path never allocates
+    switch_t *sw = calloc(1, sizeof(*sw));
+    if (sw == NULL) {
+        return NULL;
+    }
+    strncpy(sw->name, name, SWITCH_NAME_LEN - 1);
+    mac_table_init(&sw->mac_table);
     for (int i = 0; i < MAX_PORTS; i++) {
-        switch_inst.port[i].socket_fd = -1;
+        sw->port[i].socket_fd = -1;
+        sw->port[i].uring_slot = -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    int slot = -1;
+    for (int i = 0; i < MAX_SWITCHES; i++) {
+        if (instances[i] != NULL && strcmp(instances[i]->name, name) == 0) {
+            slot = -1;
+            break; // Name already taken
+        }
+        if (instances[i] == NULL && slot == -1) {
+            slot = i;
+        }
+    }
+
+    if (slot == -1) {
+        pthread_mutex_unlock(&lock);
+        free(sw);
+        return NULL;
+    }
+
+    /* Warm start: bulk-load the last snapshot so known hosts are forwarded to
+     * right away instead of being flooded until they are relearned. No worker
+     * serves the instance yet, so the table can be written directly.
+     */
+    if (snapshot_dir[0] != '\0') {
+        char path[PATH_MAX + SWITCH_NAME_LEN + 8];
+        snapshot_path(name, path, sizeof(path));
+        time_t deadline = (time_t)(now_us() / 1000000) + MAC_PROVISIONAL_TIMEOUT_S;
+        int loaded = mac_table_load(&sw->mac_table, path, MAX_PORTS, deadline);
+        if (loaded >= 0) {
+            printf("[%s] Warm start: %d MAC entries loaded from %s\n", name, loaded, path);
+        }
+    }
+
+    instances[slot] = sw;
+    pthread_mutex_unlock(&lock);
+
+    return sw;
+}
+
+int switch_start(switch_t *sw) {
+    pthread_mutex_lock(&lock);
+    if (sw->worker != NULL || num_workers == 0) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    // Hand the instance to the least loaded worker
+    switch_worker_t *worker = &workers[0];
+    for (int i = 1; i < num_workers; i++) {
+        if (workers[i].num_instances < worker->num_instances) {
+            worker = &workers[i];
+        }
+    }
+    worker->instances[worker->num_instances++] = sw;
+    sw->worker = worker;
+    notify_worker(worker);
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+void switch_stop(switch_t *sw) {
+    pthread_mutex_lock(&lock);
+
+    // The worker may be inside poll() or the data path, let it drop the instance itself
+    if (sw->worker != NULL) {
+        sw->request_stop = true;
+        notify_worker(sw->worker);
+        while (sw->worker != NULL) {
+            pthread_cond_wait(&instance_stopped, &lock);
+        }
+    }
+
+    for (int i = 0; i < MAX_SWITCHES; i++) {
+        if (instances[i] == sw) {
+            instances[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    free_acls(sw);
+    free(sw);
+}
+
+switch_t *switch_find(const char *name) {
+    switch_t *found = NULL;
+
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < MAX_SWITCHES; i++) {
+        if (instances[i] != NULL && strcmp(instances[i]->name, name) == 0) {
+            found = instances[i];
+            break;
+        }
     }
+    pthread_mutex_unlock(&lock);
+
+    return found;
 }
 
-void switch_start(void) {
-    pthread_create(&switch_thread_id, NULL, switch_thread_func, NULL);
+const char *switch_name(const switch_t *sw) {
+    return sw->name;
+}
+
+void switch_list(void) {
+    printf("%-16s %-8s %s\n", "NAME", "WORKER", "PORTS UP");
+
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < MAX_SWITCHES; i++) {
+        switch_t *sw = instances[i];
+        if (sw == NULL) {
+            continue;
+        }
+
+        int ports_up = 0;
+        for (int port = 0; port < MAX_PORTS; port++) {
+            ports_up += sw->port[port].is_active;
+        }
+
+        if (sw->worker != NULL) {
+            printf("%-16s %-8d %d/%d\n", sw->name, sw->worker->index, ports_up, MAX_PORTS);
+        } else {
+            printf("%-16s %-8s %d/%d\n", sw->name, "-", ports_up, MAX_PORTS);
+        }
+    }
+    pthread_mutex_unlock(&lock);
 }
 
-void switch_stop(void) {
-    switch_inst.shutdown = true;
-    pthread_join(switch_thread_id, NULL);
+int switch_connect_port(switch_t *sw, int port, const char *iface_name) {
+    int port_idx = port - 1; // Convert from 1-based to 0-based
+
+    if (port_idx < 0 || port_idx >= MAX_PORTS) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    strncpy(sw->port[port_idx].pending_name, iface_name, IFNAMSIZ);
+    sw->port[port_idx].request_connect = true;
+    if (sw->worker != NULL) {
+        notify_worker(sw->worker);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return 0;
 }
 
-int switch_connect_port(int port, const char *iface_name) {
+int switch_disconnect_port(switch_t *sw, int port) {
     int port_idx = port - 1; // Convert from 1-based to 0-based
 
     if (port_idx < 0 || port_idx >= MAX_PORTS) {
@@ -279,14 +1632,38 @@ int switch_connect_port(int port, const char *iface_name) {
     }
 
     pthread_mutex_lock(&lock);
-    strncpy(switch_inst.port[port_idx].pending_name, iface_name, IFNAMSIZ);
-    switch_inst.port[port_idx].request_connect = true;
+    sw->port[port_idx].request_disconnect = true;
+    if (sw->worker != NULL) {
+        notify_worker(sw->worker);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+int switch_enable_snapshots(const char *dir, int interval_s) {
+    if (strlen(dir) >= sizeof(snapshot_dir) || interval_s < 0) {
+        return -1;
+    }
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror("Creating snapshot directory failed");
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    strcpy(snapshot_dir, dir);
+    snapshot_interval_s = interval_s;
     pthread_mutex_unlock(&lock);
 
+    if (interval_s > 0 && !snapshot_thread_running) {
+        pthread_create(&snapshot_thread_id, NULL, snapshot_thread_func, NULL);
+        snapshot_thread_running = true;
+    }
+
     return 0;
 }
 
-int switch_disconnect_port(int port) {
+int switch_add_static_mac(switch_t *sw, const unsigned char *mac, int port) {
     int port_idx = port - 1; // Convert from 1-based to 0-based
 
     if (port_idx < 0 || port_idx >= MAX_PORTS) {
@@ -294,18 +1671,224 @@ int switch_disconnect_port(int port) {
     }
 
     pthread_mutex_lock(&lock);
-    switch_inst.port[port_idx].request_disconnect = true;
+    queue_mac_request(sw, mac, port_idx);
     pthread_mutex_unlock(&lock);
 
     return 0;
 }
 
-void switch_show_port_status(void) {
+int switch_remove_static_mac(switch_t *sw, const unsigned char *mac) {
+    pthread_mutex_lock(&lock);
+    queue_mac_request(sw, mac, -1);
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+void switch_show_mac_table(const switch_t *sw) {
+    // Read without stopping the engine, like the port status: good enough for a debug view
+    mac_table_print(&sw->mac_table);
+}
+
+int switch_acl_add(switch_t *sw, int port, const acl_rule_t *rule) {
+    int port_idx = port - 1; // Convert from 1-based to 0-based
+
+    if (port_idx < 0 || port_idx >= MAX_PORTS) {
+        return -1;
+    }
+    if (rule->action == ACL_MIRROR && (rule->mirror_port < 0 || rule->mirror_port >= MAX_PORTS)) {
+        return -1;
+    }
+    if (rule->action == ACL_RATE_LIMIT && rule->rate_pps == 0) {
+        return -1;
+    }
+
+    // Control path only, the table is never touched by the Switch Engine
+    switch_port_info_t *info = &sw->port[port_idx];
+    if (info->acl_rules == NULL) {
+        info->acl_rules = acl_table_create();
+        if (info->acl_rules == NULL) {
+            return -1;
+        }
+    }
+
+    int id = acl_table_add(info->acl_rules, rule);
+    if (id >= 0) {
+        info->acl_dirty = true;
+    }
+    return id;
+}
+
+int switch_acl_remove(switch_t *sw, int port, int rule_id) {
+    int port_idx = port - 1; // Convert from 1-based to 0-based
+
+    if (port_idx < 0 || port_idx >= MAX_PORTS || sw->port[port_idx].acl_rules == NULL) {
+        return -1;
+    }
+    if (acl_table_remove(sw->port[port_idx].acl_rules, rule_id) < 0) {
+        return -1;
+    }
+    sw->port[port_idx].acl_dirty = true;
+
+    return 0;
+}
+
+int switch_acl_clear(switch_t *sw, int port) {
+    int port_idx = port - 1; // Convert from 1-based to 0-based
+
+    if (port_idx < 0 || port_idx >= MAX_PORTS) {
+        return -1;
+    }
+    if (sw->port[port_idx].acl_rules == NULL) {
+        return 0;
+    }
+
+    for (int id = 0; id < ACL_MAX_RULES; id++) {
+        acl_table_remove(sw->port[port_idx].acl_rules, id);
+    }
+    sw->port[port_idx].acl_dirty = true;
+
+    return 0;
+}
+
+int switch_acl_commit(switch_t *sw) {
+    int ret = 0;
+
+    for (int port = 0; port < MAX_PORTS; port++) {
+        if (sw->port[port].acl_dirty && publish_acl(sw, port) < 0) {
+            ret = -1; // Keep the old rules on this port, it stays dirty
+        }
+    }
+    return ret;
+}
+
+int switch_acl_commit_all(void) {
+    switch_t *pending[MAX_SWITCHES];
+    int num_pending = 0;
+    int ret = 0;
+
+    // Only the CLI creates and deletes instances, so the handles stay valid after unlocking
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < MAX_SWITCHES; i++) {
+        if (instances[i] != NULL) {
+            pending[num_pending++] = instances[i];
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < num_pending; i++) {
+        if (switch_acl_commit(pending[i]) < 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+int switch_acl_show(const switch_t *sw, int port) {
+    int port_idx = port - 1; // Convert from 1-based to 0-based
+
+    if (port_idx < 0 || port_idx >= MAX_PORTS) {
+        return -1;
+    }
+
+    if (sw->port[port_idx].acl_rules == NULL) {
+        printf("0 rules\n");
+    } else {
+        acl_table_print(sw->port[port_idx].acl_rules);
+    }
+    return 0;
+}
+
+int switch_enable_busy_poll(int cpu, int idle_us) {
+    if (cpu < 0 || cpu + num_workers > CPU_SETSIZE || idle_us <= 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    latency_config.busy_poll = true;
+    latency_config.cpu = cpu;
+    latency_config.idle_us = idle_us;
+    latency_config.generation++;
+    for (int i = 0; i < num_workers; i++) {
+        notify_worker(&workers[i]);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+void switch_disable_busy_poll(void) {
+    pthread_mutex_lock(&lock);
+    latency_config.busy_poll = false;
+    latency_config.generation++;
+    for (int i = 0; i < num_workers; i++) {
+        notify_worker(&workers[i]);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void switch_show_stats(const switch_t *sw) {
+    printf("--------------------------------\n");
+    if (latency_config.busy_poll) {
+        printf("Mode: busy-poll on CPUs %d-%d, idle fallback %d us\n",
+               latency_config.cpu, latency_config.cpu + num_workers - 1, latency_config.idle_us);
+    } else {
+        printf("Mode: blocking\n");
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        switch_stats_t *stats = &workers[i].stats;
+        uint64_t total = stats->busy_us + stats->spin_us + stats->blocked_us;
+        double scale = total ? 100.0 / total : 0.0;
+
+        printf("Worker %d: %s, %d instance(s), %s, busy %.2f%% / spinning %.2f%% / blocked %.2f%% of the time (CPU %.2f%%), pool exhausted %lu times\n",
+               i, workers[i].backend == SWITCH_BACKEND_URING ? "io_uring" : "poll",
+               workers[i].num_instances, stats->spinning ? "spinning" : "sleeping",
+               stats->busy_us * scale, stats->spin_us * scale, stats->blocked_us * scale,
+               (stats->busy_us + stats->spin_us) * scale,
+               (unsigned long)stats->pool_empty);
+    }
+
+    printf("Frame pool: %u/%u free (%s)\n",
+           frame_pool_available(), frame_pool_size(),
+           frame_pool_on_huge_pages() ? "huge pages" : "regular pages");
+    for (int i = 0; i < MAX_PORTS; i++) {
+        printf("%s Port %d TX drops: %lu\n", sw->name, i + 1, (unsigned long)sw->port[i].tx_queue.drops);
+    }
+    printf("--------------------------------\n");
+}
+
+void switch_show_latency(switch_t *sw) {
+    static const char *path_names[PATH_COUNT] = {"unicast", "flood"};
+
+    printf("%-6s %-8s %10s %10s %10s %10s %10s\n", "PORT", "PATH", "FRAMES", "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+    for (int i = 0; i < MAX_PORTS; i++) {
+        for (int path = 0; path < PATH_COUNT; path++) {
+            latency_hist_t *hist = &sw->latency_hist[i][path];
+            printf("%-6d %-8s %10lu %10.1f %10.1f %10.1f %10.1f\n", i + 1, path_names[path],
+                   (unsigned long)latency_hist_count(hist),
+                   latency_hist_percentile(hist, 50.0) / 1000.0,
+                   latency_hist_percentile(hist, 99.0) / 1000.0,
+                   latency_hist_percentile(hist, 99.9) / 1000.0,
+                   latency_hist_max(hist) / 1000.0);
+        }
+    }
+}
+
+void switch_reset_latency(switch_t *sw) {
+    for (int i = 0; i < MAX_PORTS; i++) {
+        for (int path = 0; path < PATH_COUNT; path++) {
+            latency_hist_reset(&sw->latency_hist[i][path]);
+        }
+    }
+}
+
+void switch_show_port_status(const switch_t *sw) {
     for (int i = 0; i < MAX_PORTS; i++) {
         printf("--------------------------------\n");
         printf("PORT %d:\n", i + 1);
-        printf("Status: %s\n", switch_inst.port[i].is_active ? "UP" : "DOWN");
-        printf("Connected to: %s\n", switch_inst.port[i].is_active ? switch_inst.port[i].if_name : "Not connected");
+        printf("Status: %s\n", sw->port[i].is_active ? "UP" : "DOWN");
+        printf("Connected to: %s\n", sw->port[i].is_active ? sw->port[i].if_name : "Not connected");
         printf("--------------------------------\n");
     }
 }
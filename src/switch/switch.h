@@ -1,44 +1,244 @@
 #ifndef SWITCH_H
 #define SWITCH_H
 
-#define MAX_PORTS 4
+#include "acl.h"
+
+#define MAX_PORTS 4        // Ports per switch instance
+#define MAX_SWITCHES 64    // Switch instances (bridge domains) per process
+#define MAX_WORKERS 16     // Switch Engine threads shared by all instances
+#define SWITCH_NAME_LEN 16
+
+/* A switch instance (bridge domain) with its own ports and MAC table.
+ * Instances are served by a shared pool of Switch Engine worker threads.
+ */
+typedef struct switch_st switch_t;
+
+/* How the workers move frames between the kernel and the switch. */
+typedef enum switch_backend_en {
+    SWITCH_BACKEND_POLL = 0, // poll() + recvmsg()/write(), one syscall per frame
+    SWITCH_BACKEND_URING,    // io_uring multishot recvmsg into provided buffers, batched sends
+} switch_backend_t;
+
+/**
+ * @brief Allocate the shared frame pool and start the worker threads.
+ *        Must be called before any instance is started.
+ *
+ * @param worker_count Number of Switch Engine threads (1 to MAX_WORKERS)
+ * @param backend Port backend. Workers fall back to poll() if io_uring is not available
+ * @return 0 on success, -1 on invalid worker count or allocation failure
+ */
+int switch_system_init(int worker_count, switch_backend_t backend);
+
+/**
+ * @brief Stop the worker threads and release all instances and the frame pool.
+ */
+void switch_system_shutdown(void);
+
+/**
+ * @brief Create a switch instance. It does not forward until started.
+ *
+ * @param name Unique name of the instance: shorter than SWITCH_NAME_LEN, letters, digits, '_' and '-' only
+ * @return The instance handle, or NULL if the name is invalid or taken, or MAX_SWITCHES is reached
+ */
+switch_t *switch_init(const char *name);
+
+/**
+ * @brief Start forwarding on an instance by handing it to the least loaded worker.
+ *
+ * @param sw The switch instance
+ * @return 0 on success, -1 if it is already started or no workers are running
+ */
+int switch_start(switch_t *sw);
+
+/**
+ * @brief Stop an instance, close its ports and release it.
+ *        Blocks until its worker has let go of it. The handle is invalid afterwards.
+ *
+ * @param sw The switch instance
+ */
+void switch_stop(switch_t *sw);
 
 /**
- * @brief Initialize the switch instance.
+ * @brief Look up an instance by name.
+ *
+ * @param name Name of the instance
+ * @return The instance handle, or NULL if not found
  */
-void switch_init(void);
+switch_t *switch_find(const char *name);
 
 /**
- * @brief Start the switch engine in a background thread.
+ * @brief Get the name of an instance.
+ *
+ * @param sw The switch instance
+ * @return The name
  */
-void switch_start(void);
+const char *switch_name(const switch_t *sw);
 
 /**
- * @brief Signal the switch engine to stop and wait for it to finish.
+ * @brief Print all instances with their worker and port count.
  */
-void switch_stop(void);
+void switch_list(void);
 
 /**
  * @brief Request the switch engine to connect a port to an interface.
  *
+ * @param sw The switch instance
  * @param port Port number (1-based, 1 to MAX_PORTS)
  * @param iface_name Name of the network interface (e.g., "veth1")
  * @return 0 on success, -1 on invalid port
  */
-int switch_connect_port(int port, const char *iface_name);
+int switch_connect_port(switch_t *sw, int port, const char *iface_name);
 
 /**
  * @brief Request the switch engine to disconnect a port.
  *
+ * @param sw The switch instance
+ * @param port Port number (1-based, 1 to MAX_PORTS)
+ * @return 0 on success, -1 on invalid port
+ */
+int switch_disconnect_port(switch_t *sw, int port);
+
+/**
+ * @brief Enable MAC table snapshots in a directory (one <name>.mac file per instance).
+ *        Instances created afterwards warm-start from their snapshot, with the
+ *        loaded entries marked provisional until traffic confirms them.
+ *        Call before creating instances.
+ *
+ * @param dir Snapshot directory, created if missing
+ * @param interval_s Seconds between periodic snapshots (0 = only on exit)
+ * @return 0 on success, -1 on invalid arguments or if the directory cannot be created
+ */
+int switch_enable_snapshots(const char *dir, int interval_s);
+
+/**
+ * @brief Request a static (non-aging, non-movable) MAC entry.
+ *        Blocks while the instance's request queue is full.
+ *
+ * @param sw The switch instance
+ * @param mac The MAC address
+ * @param port Port number (1-based, 1 to MAX_PORTS)
+ * @return 0 on success, -1 on invalid port
+ */
+int switch_add_static_mac(switch_t *sw, const unsigned char *mac, int port);
+
+/**
+ * @brief Request the removal of a static MAC entry.
+ *        Blocks while the instance's request queue is full.
+ *
+ * @param sw The switch instance
+ * @param mac The MAC address
+ * @return 0 (the change is applied by the Switch Engine)
+ */
+int switch_remove_static_mac(switch_t *sw, const unsigned char *mac);
+
+/**
+ * @brief Print the MAC table of an instance.
+ *
+ * @param sw The switch instance
+ */
+void switch_show_mac_table(const switch_t *sw);
+
+/**
+ * @brief Add an ingress ACL rule to a port. It takes effect at the next
+ *        switch_acl_commit().
+ *
+ * @param sw The switch instance
+ * @param port Port number (1-based, 1 to MAX_PORTS)
+ * @param rule The rule (mirror_port is 0-based)
+ * @return The rule id, or -1 on invalid port or rule, full table or allocation failure
+ */
+int switch_acl_add(switch_t *sw, int port, const acl_rule_t *rule);
+
+/**
+ * @brief Remove an ingress ACL rule from a port. It takes effect at the next
+ *        switch_acl_commit().
+ *
+ * @param sw The switch instance
+ * @param port Port number (1-based, 1 to MAX_PORTS)
+ * @param rule_id Id returned by switch_acl_add()
+ * @return 0 on success, -1 on invalid port or rule id
+ */
+int switch_acl_remove(switch_t *sw, int port, int rule_id);
+
+/**
+ * @brief Remove all ingress ACL rules from a port. It takes effect at the next
+ *        switch_acl_commit().
+ *
+ * @param sw The switch instance
+ * @param port Port number (1-based, 1 to MAX_PORTS)
+ * @return 0 on success, -1 on invalid port
+ */
+int switch_acl_clear(switch_t *sw, int port);
+
+/**
+ * @brief Recompile the ACLs of the ports of an instance whose rules changed
+ *        and swap them in, without pausing forwarding. Batching changes into
+ *        one commit keeps loading thousands of rules linear.
+ *
+ * @param sw The switch instance
+ * @return 0 on success, -1 on allocation failure (the old rules stay in place)
+ */
+int switch_acl_commit(switch_t *sw);
+
+/**
+ * @brief switch_acl_commit() on every instance.
+ *
+ * @return 0 on success, -1 if any commit failed
+ */
+int switch_acl_commit_all(void);
+
+/**
+ * @brief Print the ingress ACL rules of a port with their hit counters.
+ *
+ * @param sw The switch instance
  * @param port Port number (1-based, 1 to MAX_PORTS)
  * @return 0 on success, -1 on invalid port
  */
-int switch_disconnect_port(int port);
+int switch_acl_show(const switch_t *sw, int port);
+
+/**
+ * @brief Switch the workers to low-latency busy-poll mode.
+ *        Worker N is pinned to CPU cpu + N and spins on its port sockets,
+ *        falling back to blocking poll() after idle_us without traffic.
+ *
+ * @param cpu CPU core to pin the first worker to
+ * @param idle_us Idle period in microseconds before falling back to blocking
+ * @return 0 on success, -1 on invalid arguments
+ */
+int switch_enable_busy_poll(int cpu, int idle_us);
+
+/**
+ * @brief Switch the workers back to blocking poll() mode and unpin them.
+ */
+void switch_disable_busy_poll(void);
+
+/**
+ * @brief Print the worker stats (poll mode, share of time spent busy, spinning
+ *        and blocked) and the TX drops of an instance.
+ *
+ * @param sw The switch instance
+ */
+void switch_show_stats(const switch_t *sw);
+
+/**
+ * @brief Print the RX-to-TX latency percentiles per egress port and path.
+ *
+ * @param sw The switch instance
+ */
+void switch_show_latency(switch_t *sw);
+
+/**
+ * @brief Clear the latency histograms.
+ *
+ * @param sw The switch instance
+ */
+void switch_reset_latency(switch_t *sw);
 
 /**
  * @brief Print the status of the switch ports.
  *
+ * @param sw The switch instance
  */
-void switch_show_port_status(void);
+void switch_show_port_status(const switch_t *sw);
 
 #endif // SWITCH_H